@@ -1,9 +1,29 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "Poco/Delegate.h"
 #include "Poco/Data/SQLite/Connector.h"
+#include "Poco/DateTime.h"
+#include "Poco/DateTimeParser.h"
+#include "Poco/DeflatingStream.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
 #include "gtest/gtest.h"
 
+#include "tradelib/BarCache.h"
+#include "tradelib/BarIndex.h"
+#include "tradelib/BarPrefetcher.h"
+#include "tradelib/BarStore.h"
+#include "tradelib/BinaryFile.h"
+#include "tradelib/CsvReader.h"
+#include "tradelib/DateParser.h"
+#include "tradelib/EventLog.h"
+#include "tradelib/MarketData.h"
+#include "tradelib/NumberParser.h"
 #include "tradelib/PinnacleDataFeed.h"
 
 using namespace tradelib;
@@ -77,4 +97,471 @@ TEST(PinnacleDataFeed, BarProcessing)
    {
       ASSERT_LE(bl.bars[ii - 1].timestamp, bl.bars[ii].timestamp);
    }
-}
\ No newline at end of file
+}
+
+TEST(CsvReader, MappedMatchesStream)
+{
+   std::ifstream stream("feed_dir/ES_REV.CSV");
+   CsvReader streamReader(&stream);
+   CsvReader mappedReader("feed_dir/ES_REV.CSV");
+
+   std::vector<std::string> columns;
+   CsvFieldVector fields;
+   sint lines = 0;
+   while (streamReader.next(columns))
+   {
+      ASSERT_TRUE(mappedReader.next(fields));
+      ASSERT_EQ(columns.size(), fields.size());
+      for (sint ii = 0; ii < columns.size(); ++ii)
+      {
+         ASSERT_EQ(columns[ii], fields[ii].str());
+      }
+      ++lines;
+   }
+
+   ASSERT_FALSE(mappedReader.next(fields));
+   ASSERT_TRUE(mappedReader.eof());
+   ASSERT_EQ(lines, 4259);
+
+   // A missing file reads as empty
+   CsvReader missing("feed_dir/MISSING.CSV");
+   ASSERT_TRUE(missing.eof());
+   ASSERT_FALSE(missing.next(fields));
+}
+
+TEST(CsvReader, GzipMatchesPlain)
+{
+   const std::string gzPath = "feed_dir/ES_REV.CSV.gz";
+   {
+      std::ifstream plain("feed_dir/ES_REV.CSV", std::ios::binary);
+      Poco::FileOutputStream file(gzPath, std::ios::out | std::ios::trunc | std::ios::binary);
+      Poco::DeflatingOutputStream deflater(file, Poco::DeflatingStreamBuf::STREAM_GZIP);
+      deflater << plain.rdbuf();
+      deflater.close();
+   }
+
+   CsvReader plainReader("feed_dir/ES_REV.CSV");
+   CsvReader gzReader(gzPath);
+
+   CsvFieldVector expected, actual;
+   sint lines = 0;
+   while (plainReader.next(expected))
+   {
+      ASSERT_TRUE(gzReader.next(actual));
+      ASSERT_EQ(expected.size(), actual.size());
+      for (sint ii = 0; ii < expected.size(); ++ii)
+      {
+         ASSERT_EQ(expected[ii].str(), actual[ii].str());
+      }
+      ++lines;
+   }
+
+   ASSERT_FALSE(gzReader.next(actual));
+   ASSERT_TRUE(gzReader.eof());
+   ASSERT_EQ(lines, 4259);
+
+   Poco::File(gzPath).remove();
+
+   ASSERT_THROW(CsvReader("feed_dir/ES_REV.CSV.zst"), Poco::NotImplementedException);
+}
+
+TEST(DateParser, FixedLayouts)
+{
+   int tzd;
+   DateParser compact("%Y%m%d");
+   DateParser dashed("%Y-%m-%d");
+   DateParser full("%Y-%m-%d %H:%M:%S");
+
+   const char * dates[] = { "19700101", "19691231", "19970911", "20000229", "20141231", "21000301" };
+   for (auto date : dates)
+   {
+      std::string s(date);
+      std::string d = s.substr(0, 4) + "-" + s.substr(4, 2) + "-" + s.substr(6, 2);
+      ASSERT_EQ(compact.parse(s), Poco::DateTimeParser::parse("%Y%m%d", s, tzd).timestamp());
+      ASSERT_EQ(dashed.parse(d), Poco::DateTimeParser::parse("%Y-%m-%d", d, tzd).timestamp());
+      ASSERT_EQ(full.parse(d + " 16:00:01"), Poco::DateTimeParser::parse("%Y-%m-%d %H:%M:%S", d + " 16:00:01", tzd).timestamp());
+   }
+
+   // Invalid dates are left to Poco
+   ASSERT_THROW(compact.parse(std::string("20140230")), Poco::SyntaxException);
+
+   // Any other format goes through Poco
+   DateParser other("%d/%m/%Y");
+   ASSERT_EQ(other.parse(std::string("11/09/1997")), compact.parse(std::string("19970911")));
+}
+
+TEST(BarCache, RoundTrip)
+{
+   const std::string csvPath = "feed_dir/ES_REV.CSV";
+   Poco::File cacheFile(BarCache::cachePath(csvPath));
+   if (cacheFile.exists()) cacheFile.remove();
+   ASSERT_FALSE(BarCache::isFresh(csvPath, "%Y%m%d"));
+
+   BarCache::convert("ES", csvPath, "%Y%m%d");
+   ASSERT_TRUE(BarCache::isFresh(csvPath, "%Y%m%d"));
+   // Parsed with another date format
+   ASSERT_FALSE(BarCache::isFresh(csvPath, "%Y-%m-%d"));
+
+   BarFileReader csvReader("ES", csvPath, "%Y%m%d");
+   BarCacheReader cacheReader("ES", BarCache::cachePath(csvPath));
+
+   Bar expected, actual;
+   sint bars = 0;
+   while (csvReader.next(expected))
+   {
+      ASSERT_TRUE(cacheReader.next(actual));
+      ASSERT_EQ(expected.symbol, actual.symbol);
+      ASSERT_EQ(expected.timestamp, actual.timestamp);
+      ASSERT_EQ(expected.open, actual.open);
+      ASSERT_EQ(expected.high, actual.high);
+      ASSERT_EQ(expected.low, actual.low);
+      ASSERT_EQ(expected.close, actual.close);
+      ASSERT_EQ(expected.volume, actual.volume);
+      ASSERT_EQ(expected.interest, actual.interest);
+      ASSERT_EQ(expected.isLast(), actual.isLast());
+      ++bars;
+   }
+   ASSERT_FALSE(cacheReader.next(actual));
+   ASSERT_EQ(bars, 4259);
+
+   // The cache is bound to its symbol
+   ASSERT_THROW(BarCacheReader("YM", BarCache::cachePath(csvPath)), BarCacheException);
+
+   Poco::File(BarCache::cachePath(csvPath)).remove();
+}
+
+TEST(BinaryFile, WriteAndCheck)
+{
+   const std::string path = "feed_dir/test.binary";
+
+   // A failed write leaves neither the file nor the temporary one
+   ASSERT_THROW(BinaryFile::write<Poco::IOException>(path, [](std::ostream & os) { os << "partial"; throw Poco::IOException("interrupted"); }), Poco::IOException);
+   ASSERT_FALSE(Poco::File(path).exists());
+   ASSERT_FALSE(Poco::File(path + ".tmp").exists());
+
+   BinaryFile::write<Poco::IOException>(path, [](std::ostream & os) { os << "complete"; });
+   ASSERT_TRUE(Poco::File(path).exists());
+   ASSERT_FALSE(Poco::File(path + ".tmp").exists());
+   Poco::File(path).remove();
+
+   const uint32 magic = BarStoreHeader::MAGIC;
+   ASSERT_TRUE(BinaryFile::matches(magic, 1, magic, 1));
+   ASSERT_FALSE(BinaryFile::matches(magic, 2, magic, 1));
+   ASSERT_THROW(BinaryFile::check<Poco::IOException>(magic + 1, 1, magic, 1, path), Poco::IOException);
+   ASSERT_THROW(BinaryFile::check<Poco::IOException>(magic, 2, magic, 1, path), Poco::IOException);
+
+   // The magic of a file written with the other byte order is told apart
+   try
+   {
+      BinaryFile::check<Poco::IOException>(0x544c4253, 1, magic, 1, path);
+      FAIL();
+   }
+   catch (Poco::IOException & e)
+   {
+      ASSERT_NE(e.message().find("byte order"), std::string::npos);
+   }
+}
+
+class BarCollector
+{
+public:
+   std::vector<Bar> bars;
+
+   void onBar(const Bar & bar) { bars.push_back(bar); }
+};
+
+TEST(BarStore, Attach)
+{
+   const std::string path = "feed_dir/test.barstore";
+   PinnacleDataFeed source;
+   source.configure("pinnacle.sqlite");
+   MarketData data(source, { "ES", "YM" });
+   BarStore::publish(data, path);
+
+   BarStoreFeed feed(path);
+   ASSERT_EQ(feed.rows(), data.bars().size());
+   const Instrument * instrument = feed.getInstrument("YM");
+   ASSERT_NE(instrument, nullptr);
+   ASSERT_EQ(instrument->tick(), source.getInstrument("YM")->tick());
+   ASSERT_EQ(instrument->bpv(), source.getInstrument("YM")->bpv());
+   ASSERT_EQ(instrument->isFuture(), source.getInstrument("YM")->isFuture());
+   ASSERT_EQ(feed.getInstrument("JN"), nullptr);
+   ASSERT_THROW(feed.subscribe("JN"), Poco::NotFoundException);
+
+   // The variations of the source
+   const InstrumentVariation * variation = feed.getInstrumentVariation("ib", "FN");
+   ASSERT_NE(variation, nullptr);
+   ASSERT_EQ(variation->symbol, "EUR");
+   ASSERT_EQ(variation->factor, 100.0);
+   ASSERT_EQ(variation->tick, 0.0001);
+   ASSERT_EQ(feed.instrumentVariations().size(), source.instrumentVariations().size());
+   ASSERT_EQ(feed.instrumentVariations().at("ib").size(), source.instrumentVariations().at("ib").size());
+
+   // Only the subscribed symbols, in the order of the market data
+   feed.subscribe("YM");
+   BarCollector collector;
+   feed.run(collector);
+   std::vector<Bar> expected;
+   for (const Bar & bar : data.bars())
+   {
+      if (bar.symbol == "YM") expected.push_back(bar);
+   }
+   ASSERT_EQ(collector.bars.size(), expected.size());
+   for (sint ii = 0; ii < expected.size(); ++ii)
+   {
+      ASSERT_EQ(collector.bars[ii].symbol, expected[ii].symbol);
+      ASSERT_EQ(collector.bars[ii].timestamp, expected[ii].timestamp);
+      ASSERT_EQ(collector.bars[ii].open, expected[ii].open);
+      ASSERT_EQ(collector.bars[ii].high, expected[ii].high);
+      ASSERT_EQ(collector.bars[ii].low, expected[ii].low);
+      ASSERT_EQ(collector.bars[ii].close, expected[ii].close);
+      ASSERT_EQ(collector.bars[ii].volume, expected[ii].volume);
+      ASSERT_EQ(collector.bars[ii].isLast(), ii == expected.size() - 1);
+   }
+
+   // The last bar of the subscribed symbols is flagged, whichever symbol ends the store
+   for (const std::string symbol : { "ES", "YM" })
+   {
+      feed.reset();
+      feed.subscribe(symbol);
+      BarCollector single;
+      feed.run(single);
+      ASSERT_GT(single.bars.size(), 0u);
+      ASSERT_TRUE(single.bars.back().isLast());
+      ASSERT_EQ(std::count_if(single.bars.begin(), single.bars.end(), [](const Bar & bar) { return bar.isLast(); }), 1);
+   }
+
+   // A store of the wrong size is rejected
+   {
+      Poco::FileOutputStream os(path, std::ios::out | std::ios::app | std::ios::binary);
+      os << "x";
+   }
+   ASSERT_THROW(BarStoreFeed other(path), BarStoreException);
+
+   Poco::File(path).remove();
+}
+
+TEST(EventLog, Subset)
+{
+   const std::string path = "feed_dir/test.eventlog";
+   PinnacleDataFeed source;
+   source.configure("pinnacle.sqlite");
+   // Subscribed to the source, but not in the logged universe
+   source.subscribe("ZO");
+   EventLog::write(source, { "ES", "YM", "JN" }, path);
+
+   PinnacleDataFeed other;
+   other.configure("pinnacle.sqlite");
+   MarketData data(other, { "ES", "YM", "JN" });
+
+   EventLogFeed feed(path);
+   ASSERT_EQ(feed.records(), data.bars().size());
+   ASSERT_EQ(feed.getInstrument("JN")->bpv(), other.getInstrument("JN")->bpv());
+   ASSERT_THROW(feed.subscribe("ZO"), Poco::NotFoundException);
+   const InstrumentVariation * variation = feed.getInstrumentVariation("ib", "FN");
+   ASSERT_NE(variation, nullptr);
+   ASSERT_EQ(variation->symbol, "EUR");
+   ASSERT_EQ(variation->factor, 100.0);
+   ASSERT_EQ(feed.instrumentVariations().at("ib").size(), other.instrumentVariations().at("ib").size());
+
+   // Only the subscribed symbols, in the merged order
+   for (sint run = 0; run < 2; ++run)
+   {
+      feed.subscribe("YM");
+      if (run == 1) feed.subscribe("JN");
+      BarCollector collector;
+      feed.barEvent.connect<BarCollector, &BarCollector::onBar>(&collector);
+      feed.start();
+      feed.barEvent.disconnect(&collector);
+
+      std::vector<Bar> expected;
+      for (const Bar & bar : data.bars())
+      {
+         if (bar.symbol == "YM" || (run == 1 && bar.symbol == "JN")) expected.push_back(bar);
+      }
+      ASSERT_EQ(collector.bars.size(), expected.size());
+      for (sint ii = 0; ii < expected.size(); ++ii)
+      {
+         ASSERT_EQ(collector.bars[ii].symbol, expected[ii].symbol);
+         ASSERT_EQ(collector.bars[ii].timestamp, expected[ii].timestamp);
+         ASSERT_EQ(collector.bars[ii].open, expected[ii].open);
+         ASSERT_EQ(collector.bars[ii].close, expected[ii].close);
+         ASSERT_EQ(collector.bars[ii].volume, expected[ii].volume);
+      }
+      ASSERT_TRUE(collector.bars.back().isLast());
+      feed.reset();
+   }
+
+   Poco::File(path).remove();
+}
+
+TEST(BarReader, NextBatch)
+{
+   BarFileReader direct("ES", "feed_dir/ES_REV.CSV", "%Y%m%d");
+   BarFileReader batched("ES", "feed_dir/ES_REV.CSV", "%Y%m%d");
+
+   BarBlock block;
+   Bar expected;
+   sint bars = 0;
+   while (true)
+   {
+      // Not a multiple of the ring buffer capacity
+      block.clear();
+      sint count = batched.nextBatch(block, 1000);
+      if (count == 0) break;
+
+      ASSERT_EQ(count, block.size());
+      for (sint ii = 0; ii < count; ++ii)
+      {
+         Bar actual = block.bar(ii);
+         ASSERT_TRUE(direct.next(expected));
+         ASSERT_EQ(expected.symbol, actual.symbol);
+         ASSERT_EQ(expected.timestamp, actual.timestamp);
+         ASSERT_EQ(expected.close, actual.close);
+         ASSERT_EQ(expected.isLast(), actual.isLast());
+         ++bars;
+      }
+   }
+   ASSERT_TRUE(block.empty());
+   ASSERT_EQ(bars, 4259);
+
+   // In place access, the peeked bar is the next one
+   BarFileReader reader("ES", "feed_dir/ES_REV.CSV", "%Y%m%d");
+   const Bar * peeked = reader.peek();
+   ASSERT_EQ(peeked, reader.next());
+}
+
+TEST(BarCache, NextBatch)
+{
+   const std::string csvPath = "feed_dir/ES_REV.CSV";
+   BarCache::convert("ES", csvPath, "%Y%m%d");
+
+   BarFileReader direct("ES", csvPath, "%Y%m%d");
+   BarCacheReader batched("ES", BarCache::cachePath(csvPath));
+
+   // A bar read on its own fills the ring buffer, the first batch drains it and continues
+   // from the columns
+   Bar expected, actual;
+   ASSERT_TRUE(direct.next(expected));
+   ASSERT_TRUE(batched.next(actual));
+   ASSERT_EQ(expected.timestamp, actual.timestamp);
+   sint bars = 1;
+
+   BarBlock block;
+   while (true)
+   {
+      block.clear();
+      sint count = batched.nextBatch(block, 1000);
+      if (count == 0) break;
+
+      ASSERT_EQ(count, block.size());
+      for (sint ii = 0; ii < count; ++ii)
+      {
+         actual = block.bar(ii);
+         ASSERT_TRUE(direct.next(expected));
+         ASSERT_EQ(expected.symbol, actual.symbol);
+         ASSERT_EQ(expected.timestamp, actual.timestamp);
+         ASSERT_EQ(expected.close, actual.close);
+         ASSERT_EQ(expected.volume, actual.volume);
+         ASSERT_EQ(expected.isLast(), actual.isLast());
+         ++bars;
+      }
+   }
+   ASSERT_FALSE(direct.next(expected));
+   ASSERT_EQ(bars, 4259);
+
+   Poco::File(BarCache::cachePath(csvPath)).remove();
+}
+
+TEST(BarIndex, RangeSeek)
+{
+   const std::string csvPath = "feed_dir/ES_REV.CSV";
+   BarIndex::build(csvPath, "%Y%m%d");
+   ASSERT_TRUE(BarIndex::isFresh(csvPath, "%Y%m%d"));
+   // Built with another date format
+   ASSERT_FALSE(BarIndex::isFresh(csvPath, "%Y-%m-%d"));
+   BarIndex index(BarIndex::indexPath(csvPath));
+
+   Timestamp start = Poco::DateTime(2003, 3, 15).timestamp();
+   Timestamp end = Poco::DateTime(2005, 7, 1).timestamp();
+
+   // The same range, filtered from a full scan and seeked to
+   BarFileReader scanned("ES", csvPath, "%Y%m%d");
+   BarFileReader seeked("ES", csvPath, "%Y%m%d");
+   seeked.setRange(start, end);
+   seeked.seek(index.offset(start));
+
+   Bar expected, actual;
+   sint bars = 0;
+   while (scanned.next(expected))
+   {
+      if (expected.timestamp < start || expected.timestamp >= end) continue;
+
+      ASSERT_TRUE(seeked.next(actual));
+      ASSERT_EQ(expected.timestamp, actual.timestamp);
+      ASSERT_EQ(expected.close, actual.close);
+      ++bars;
+   }
+   ASSERT_TRUE(actual.isLast());
+   ASSERT_FALSE(seeked.next(actual));
+   ASSERT_GT(bars, 0);
+
+   Poco::File(BarIndex::indexPath(csvPath)).remove();
+}
+
+TEST(BarPrefetcher, MatchesDirectDecoding)
+{
+   const std::vector<std::string> symbols = { "ES", "YM", "JN", "ZO" };
+
+   // A shallow queue makes the replay wait on the workers often
+   BarPrefetcher prefetcher(3, 5);
+   std::vector<std::unique_ptr<BarReader>> sources, direct, prefetched;
+   for (auto & ss : symbols)
+   {
+      std::string path = "feed_dir/" + ss + "_REV.CSV";
+      sources.emplace_back(new BarFileReader(ss, path, "%Y%m%d"));
+      direct.emplace_back(new BarFileReader(ss, path, "%Y%m%d"));
+      prefetched.emplace_back(prefetcher.prefetch(*sources.back()));
+   }
+   prefetcher.start();
+
+   sint bars = 0;
+   for (sint ii = 0; ii < symbols.size(); ++ii)
+   {
+      Bar expected, actual;
+      while (direct[ii]->next(expected))
+      {
+         ASSERT_TRUE(prefetched[ii]->next(actual));
+         ASSERT_EQ(expected.symbol, actual.symbol);
+         ASSERT_EQ(expected.timestamp, actual.timestamp);
+         ASSERT_EQ(expected.close, actual.close);
+         ASSERT_EQ(expected.isLast(), actual.isLast());
+         ++bars;
+      }
+      ASSERT_FALSE(prefetched[ii]->next(actual));
+      ASSERT_TRUE(prefetched[ii]->eof());
+   }
+   ASSERT_EQ(bars, 4259 + 3111 + 9220 + 9975);
+}
+
+TEST(NumberParser, MatchesStandardConversions)
+{
+   // Fast path and fallback alike must reproduce std::stod/std::stol bit for bit
+   const std::vector<std::string> decimals = { "1162.20", "-1162.25", "0", "-0", "+1.5", ".5", "5.", "0.0001", "999999999999999", "1e5", "12345678901234567.5" };
+   for (auto & dd : decimals)
+   {
+      numeric expected = std::stod(dd);
+      numeric actual = NumberParser::parseNumeric(dd.data(), dd.data() + dd.size());
+      ASSERT_EQ(0, std::memcmp(&expected, &actual, sizeof(numeric))) << dd;
+   }
+
+   const std::vector<std::string> integers = { "0", "123456789", "-42", "+7", "2147483647" };
+   for (auto & ii : integers)
+   {
+      ASSERT_EQ(std::stol(ii), NumberParser::parseLong(ii.data(), ii.data() + ii.size())) << ii;
+   }
+
+   const std::string garbage = "abc";
+   ASSERT_THROW(NumberParser::parseNumeric(garbage.data(), garbage.data() + garbage.size()), std::invalid_argument);
+   ASSERT_THROW(NumberParser::parseLong(garbage.data(), garbage.data() + garbage.size()), std::invalid_argument);
+}
@@ -0,0 +1,677 @@
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "Poco/File.h"
+
+#include "gtest/gtest.h"
+
+#include "tradelib/BarSpill.h"
+#include "tradelib/Checkpoint.h"
+#include "tradelib/FillSimulator.h"
+#include "tradelib/HistoricalReplay.h"
+#include "tradelib/Indicators.h"
+#include "tradelib/MarketData.h"
+#include "tradelib/PinnacleDataFeed.h"
+#include "tradelib/Portfolio.h"
+#include "tradelib/Replay.h"
+#include "tradelib/ShardedReplay.h"
+#include "tradelib/Strategy.h"
+#include "tradelib/Sweep.h"
+#include "tradelib/Trace.h"
+#include "tradelib/WalkForward.h"
+
+using namespace tradelib;
+
+// Long while the close is above the close "length" bars ago
+class Momentum : public Strategy
+{
+public:
+   Momentum(Broker * broker, sint length)
+      : Strategy(broker), length_(length)
+   {}
+
+   std::vector<Execution> executions;
+
+protected:
+   virtual void onBarClose(const BarHistory & history, const Bar & bar)
+   {
+      if (history.close.size() <= length_) return;
+
+      const Broker::InstrumentPosition * ip = broker_->getInstrumentPosition(bar.symbol);
+      long position = ip == nullptr ? 0 : ip->position;
+      if (position == 0 && history.close[0] > history.close[length_]) enterLong(bar.symbol);
+      else if (position > 0 && history.close[0] < history.close[length_]) exitLong(bar.symbol);
+   }
+
+   virtual void onOrderNotification(const OrderNotification & on)
+   {
+      executions.push_back(*on.execution);
+   }
+
+   sint length_;
+};
+
+class IndependentMomentum : public Momentum
+{
+public:
+   IndependentMomentum(Broker * broker, sint length)
+      : Momentum(broker, length)
+   {}
+
+   virtual bool isSymbolIndependent() const { return true; }
+};
+
+// Keeps state of its own, saved in checkpoints
+class AveragingMomentum : public Momentum
+{
+public:
+   AveragingMomentum(Broker * broker, sint length)
+      : Momentum(broker, length)
+   {}
+
+   Average average;
+
+protected:
+   virtual void onBarClose(const BarHistory & history, const Bar & bar)
+   {
+      average.add(bar.close);
+      Momentum::onBarClose(history, bar);
+   }
+
+   virtual void saveState(Poco::BinaryWriter & writer) const { average.save(writer); }
+   virtual void loadState(Poco::BinaryReader & reader) { average.load(reader); }
+};
+
+// Declares its lookback, so the histories keep the last bars only
+class BoundedMomentum : public Momentum
+{
+public:
+   BoundedMomentum(Broker * broker, sint length)
+      : Momentum(broker, length), maxHistory(0), spilled(nullptr)
+   {
+      requireLookback(length + 1);
+   }
+
+   size_t maxHistory;
+   // The history with a spill
+   const BarHistory * spilled;
+
+protected:
+   virtual void onBarClose(const BarHistory & history, const Bar & bar)
+   {
+      maxHistory = std::max(maxHistory, history.close.size());
+      if (history.spill() != nullptr) spilled = &history;
+      Momentum::onBarClose(history, bar);
+   }
+};
+
+// Records the executions of a fill simulator
+class ExecutionHandler
+{
+public:
+   std::vector<Execution> executions;
+
+   void onBarOpen(const Bar & bar) {}
+   void onBarClose(const Bar & bar) {}
+   void onBarClosed(const Bar & bar) {}
+   void onOrderNotification(const OrderNotification & on) { executions.push_back(*on.execution); }
+};
+
+// Submits a ladder of stop limit orders at the close of the first bar
+class LadderHandler : public ExecutionHandler
+{
+public:
+   LadderHandler(FillSimulator & simulator)
+      : simulator_(simulator), bars_(0)
+   {}
+
+   void onBarClose(const Bar & bar)
+   {
+      if (bars_++ > 0) return;
+      // The highest stop first
+      for (numeric stop = 105.0; stop > 100.0; stop -= 1.0) simulator_.submitOrder(Order::enterLongStopLimit(bar.symbol, 1, stop, 200.0));
+      simulator_.submitOrder(Order::enterLongStopLimit(bar.symbol, 1, 1000.0, 2000.0));
+   }
+
+protected:
+   FillSimulator & simulator_;
+   sint bars_;
+};
+
+// A fill simulator of ES, with the bars to feed it
+class FillSimulatorTest : public ::testing::Test
+{
+protected:
+   FillSimulatorTest()
+      : simulator(&feed)
+   {
+      feed.configure("pinnacle.sqlite");
+      feed.subscribe("ES");
+   }
+
+   // A bar "days" after the first one (Jan 4 2010)
+   static Bar bar(sint days, numeric open = 100.0, numeric high = 110.0, numeric low = 90.0, numeric close = 100.0)
+   {
+      Timestamp timestamp = Poco::DateTime(2010, 1, 4).timestamp() + Timespan(days, 0, 0, 0, 0);
+      return Bar("ES", timestamp, open, high, low, close, 1);
+   }
+
+   PinnacleDataFeed feed;
+   FillSimulator simulator;
+   ExecutionHandler handler;
+};
+
+// The executions of two runs match one by one. Fatal, call it with ASSERT_NO_FATAL_FAILURE.
+void expectSameExecutions(const std::vector<Execution> & actual, const std::vector<Execution> & expected)
+{
+   ASSERT_EQ(actual.size(), expected.size());
+   for (sint ii = 0; ii < expected.size(); ++ii)
+   {
+      ASSERT_EQ(actual[ii].symbol, expected[ii].symbol);
+      ASSERT_EQ(actual[ii].timestamp, expected[ii].timestamp);
+      ASSERT_EQ(actual[ii].price, expected[ii].price);
+      ASSERT_EQ(actual[ii].quantity, expected[ii].quantity);
+   }
+}
+
+// The trades of two portfolios match, for each instrument. Fatal, call it with
+// ASSERT_NO_FATAL_FAILURE.
+void expectSameTradeStats(const Portfolio & portfolio, const Portfolio & expectedPortfolio, const std::vector<Instrument> & instruments)
+{
+   for (auto & instrument : instruments)
+   {
+      TradeStatsVector tradeStats, expectedTradeStats;
+      portfolio.getTradeStats(instrument, tradeStats);
+      expectedPortfolio.getTradeStats(instrument, expectedTradeStats);
+      ASSERT_EQ(tradeStats.size(), expectedTradeStats.size());
+      for (sint ii = 0; ii < tradeStats.size(); ++ii) ASSERT_EQ(tradeStats[ii].pnl, expectedTradeStats[ii].pnl);
+   }
+}
+
+TEST_F(FillSimulatorTest, SubmissionPriority)
+{
+   LadderHandler ladder(simulator);
+   simulator.processBar(bar(0, 100.0, 100.0, 100.0, 100.0), ladder);
+   ASSERT_TRUE(ladder.executions.empty());
+
+   // The high triggers all but the last stop - the first one submitted fills, not the lowest
+   simulator.processBar(bar(1), ladder);
+   ASSERT_EQ(ladder.executions.size(), 1u);
+   ASSERT_EQ(ladder.executions[0].price, 105.0);
+   ASSERT_EQ(ladder.executions[0].quantity, 1);
+   ASSERT_EQ(simulator.getInstrumentPosition("ES")->position, 1);
+}
+
+// Exposes the executions kept by the simulator
+class ExecutionsFillSimulator : public FillSimulator
+{
+public:
+   ExecutionsFillSimulator(DataFeed * dataFeed)
+      : FillSimulator(dataFeed)
+   {}
+
+   size_t executionsCapacity(const Symbol & symbol) { return lookupInstrumentCB(symbol).executions.capacity(); }
+};
+
+TEST_F(FillSimulatorTest, ExecutionsDontAccumulate)
+{
+   ExecutionsFillSimulator executionsSimulator(&feed);
+   const sint bars = 1000;
+   for (sint ii = 0; ii < bars; ++ii)
+   {
+      executionsSimulator.submitOrder(Order::enterLong("ES", 1));
+      executionsSimulator.submitOrder(Order::exitLong("ES", 1));
+      executionsSimulator.processBar(bar(ii), handler);
+   }
+   ASSERT_EQ(handler.executions.size(), 2u*bars);
+   // Only the fills of a bar are kept
+   ASSERT_LE(executionsSimulator.executionsCapacity(Symbol("ES")), 4u);
+}
+
+TEST_F(FillSimulatorTest, CancelAndModify)
+{
+   OrderHandle stop = simulator.submitOrder(Order::enterLongStopLimit("ES", 1, 120.0, 200.0));
+   OrderHandle cancelled = simulator.submitOrder(Order::enterLongStopLimit("ES", 1, 101.0, 200.0));
+   ASSERT_NE(stop, NO_ORDER);
+   ASSERT_NE(stop, cancelled);
+   ASSERT_TRUE(simulator.cancelOrder(cancelled));
+   ASSERT_FALSE(simulator.cancelOrder(cancelled));
+
+   simulator.processBar(bar(0), handler);
+   ASSERT_TRUE(handler.executions.empty());
+
+   // Trail the stop within the range of the next bar
+   ASSERT_TRUE(simulator.modifyOrder(stop, 105.0));
+   simulator.processBar(bar(1), handler);
+   ASSERT_EQ(handler.executions.size(), 1u);
+   ASSERT_EQ(handler.executions[0].price, 105.0);
+
+   // Filled - the handle is stale, even after its slot is reused
+   ASSERT_FALSE(simulator.modifyOrder(stop, 100.0));
+   OrderHandle next = simulator.submitOrder(Order::exitLong("ES", 1));
+   ASSERT_NE(next, stop);
+   ASSERT_FALSE(simulator.cancelOrder(stop));
+   ASSERT_TRUE(simulator.cancelOrder(next));
+}
+
+TEST_F(FillSimulatorTest, LimitAndStopFills)
+{
+   // An order of each type on the second bar, after an optional market order on the first
+   // one; the bar opens at 100 and trades between 90 and 110
+   struct Case
+   {
+      Order position;
+      Order order;
+      numeric price;
+      long quantity;
+   } cases[] =
+   {
+      { Order(), Order::enterLongLimit("ES", 1, 95.0), 95.0, 1 },
+      { Order(), Order::enterLongStop("ES", 1, 105.0), 105.0, 1 },
+      { Order(), Order::enterLongStopLimit("ES", 1, 105.0, 106.0), 105.0, 1 },
+      { Order(), Order::enterShortLimit("ES", 1, 105.0), 105.0, -1 },
+      { Order(), Order::enterShortStop("ES", 1, 95.0), 95.0, -1 },
+      { Order(), Order::enterShortStopLimit("ES", 1, 95.0, 94.0), 95.0, -1 },
+      { Order::enterLong("ES", 1), Order::exitLongLimit("ES", 1, 105.0), 105.0, -1 },
+      { Order::enterLong("ES", 1), Order::exitLongStop("ES", 1, 95.0), 95.0, -1 },
+      { Order::enterLong("ES", 1), Order::exitLongStopLimit("ES", 1, 95.0, 94.0), 95.0, -1 },
+      { Order::enterShort("ES", 1), Order::exitShortLimit("ES", 1, 95.0), 95.0, 1 },
+      { Order::enterShort("ES", 1), Order::exitShortStop("ES", 1, 105.0), 105.0, 1 },
+      { Order::enterShort("ES", 1), Order::exitShortStopLimit("ES", 1, 105.0, 106.0), 105.0, 1 },
+   };
+
+   for (size_t ii = 0; ii < sizeof(cases) / sizeof(cases[0]); ++ii)
+   {
+      SCOPED_TRACE(ii);
+      const Case & c = cases[ii];
+      FillSimulator caseSimulator(&feed);
+      ExecutionHandler caseHandler;
+      if (c.position.quantity != LONG_MIN)
+      {
+         caseSimulator.submitOrder(c.position);
+         caseSimulator.processBar(bar(0), caseHandler);
+      }
+      const size_t executions = caseHandler.executions.size();
+      caseSimulator.submitOrder(c.order);
+      caseSimulator.processBar(bar(1), caseHandler);
+      ASSERT_EQ(caseHandler.executions.size(), executions + 1);
+      ASSERT_EQ(caseHandler.executions.back().price, c.price);
+      // The transaction is signed: buys are positive, sells negative
+      ASSERT_EQ(caseSimulator.portfolio().quantity("ES"), c.quantity);
+      ASSERT_EQ(caseSimulator.portfolio().price("ES"), c.price);
+   }
+}
+
+TEST_F(FillSimulatorTest, Bracket)
+{
+   // Filled at the open, the target at the high of the same bar, the stop is cancelled
+   OrderHandle entry, target, stop;
+   simulator.submitBracket(Order::enterLong("ES", 1), Order::exitLongLimit("ES", 1, 108.0), Order::exitLongStop("ES", 1, 95.0), entry, target, stop);
+   simulator.processBar(bar(0), handler);
+   ASSERT_EQ(handler.executions.size(), 2u);
+   ASSERT_EQ(handler.executions[0].price, 100.0);
+   ASSERT_EQ(handler.executions[1].price, 108.0);
+   ASSERT_EQ(simulator.getInstrumentPosition("ES")->position, 0);
+   ASSERT_FALSE(simulator.cancelOrder(stop));
+
+   // The exits of an entry which doesn't fill go with it
+   simulator.submitBracket(Order::enterLongLimit("ES", 1, 50.0), Order::exitLongLimit("ES", 1, 108.0), Order::exitLongStop("ES", 1, 95.0), entry, target, stop);
+   simulator.processBar(bar(1), handler);
+   ASSERT_EQ(handler.executions.size(), 2u);
+   ASSERT_TRUE(simulator.cancelOrder(entry));
+   simulator.processBar(bar(2), handler);
+   ASSERT_EQ(handler.executions.size(), 2u);
+   ASSERT_FALSE(simulator.cancelOrder(target));
+   ASSERT_FALSE(simulator.cancelOrder(stop));
+
+   // One cancels the other: the stop fills at the low, the target never does
+   OrderHandle first, second;
+   simulator.submitOrder(Order::enterLong("ES", 1));
+   simulator.submitOco(Order::exitLongStop("ES", 1, 92.0), Order::exitLongLimit("ES", 1, 120.0), first, second);
+   simulator.processBar(bar(3), handler);
+   ASSERT_EQ(handler.executions.size(), 4u);
+   ASSERT_EQ(handler.executions[3].price, 92.0);
+   ASSERT_FALSE(simulator.cancelOrder(second));
+}
+
+TEST_F(FillSimulatorTest, TraceOrderLifecycle)
+{
+   Trace trace(16);
+   simulator.setTrace(&trace);
+
+   OrderHandle entry, target, stop;
+   simulator.submitBracket(Order::enterLong("ES", 1), Order::exitLongLimit("ES", 1, 108.0), Order::exitLongStop("ES", 1, 95.0), entry, target, stop);
+   simulator.processBar(bar(0), handler);
+
+   const Trace::Event expected[] =
+   {
+      Trace::Event::SUBMIT, Trace::Event::SUBMIT, Trace::Event::SUBMIT,
+      Trace::Event::FILL, Trace::Event::POSITION,
+      Trace::Event::FILL, Trace::Event::POSITION, Trace::Event::CANCEL
+   };
+   ASSERT_EQ(trace.size(), 8u);
+   for (uint32 ii = 0; ii < trace.size(); ++ii) ASSERT_EQ(trace[ii].event, expected[ii]);
+   ASSERT_EQ(trace[3].order, entry);
+   ASSERT_EQ(trace[5].order, target);
+   ASSERT_EQ(trace[5].price, 108.0);
+   ASSERT_EQ(trace[5].quantity, -1);
+   ASSERT_EQ(trace[6].quantity, 0);
+   ASSERT_EQ(trace[7].order, stop);
+
+   // Decoded offline, one line per record
+   std::stringstream saved;
+   Poco::BinaryWriter writer(saved);
+   trace.save(writer);
+   writer.flush();
+   std::ostringstream dumped;
+   Trace::dump(saved, dumped);
+   std::istringstream lines(dumped.str());
+   std::string line;
+   sint count = 0;
+   while (std::getline(lines, line))
+   {
+      ASSERT_NE(line.find(" ES "), std::string::npos);
+      ++count;
+   }
+   ASSERT_EQ(count, 8);
+
+   // The oldest records are overwritten
+   for (sint ii = 0; ii < 10; ++ii) simulator.cancelOrder(simulator.submitOrder(Order::enterLongStop("ES", 1, 200.0)));
+   ASSERT_EQ(trace.size(), 16u);
+   ASSERT_EQ(trace.dropped(), 12u);
+   ASSERT_EQ(trace[15].event, Trace::Event::CANCEL);
+}
+
+TEST(Replay, MatchesHistoricalReplay)
+{
+   PinnacleDataFeed feed;
+   feed.configure("pinnacle.sqlite");
+   HistoricalReplay historical(feed);
+   Momentum expected(&historical, 20);
+   historical.subscribe("ES");
+   historical.subscribe("YM");
+   historical.start();
+
+   PinnacleDataFeed typedFeed;
+   typedFeed.configure("pinnacle.sqlite");
+   Replay<PinnacleDataFeed, Momentum> replay(typedFeed, 20);
+   replay.subscribe("ES");
+   replay.subscribe("YM");
+   replay.start();
+
+   ASSERT_GT(expected.executions.size(), 0u);
+   ASSERT_NO_FATAL_FAILURE(expectSameExecutions(replay.strategy().executions, expected.executions));
+}
+
+TEST(InMemoryDataFeed, Rerun)
+{
+   PinnacleDataFeed source;
+   source.configure("pinnacle.sqlite");
+   InMemoryDataFeed feed(source, { "ES", "YM" });
+
+   // The instruments and the variations of the source
+   ASSERT_EQ(feed.getInstrument("ES")->bpv(), source.getInstrument("ES")->bpv());
+   ASSERT_EQ(feed.getInstrument("JN"), nullptr);
+   const InstrumentVariation * variation = feed.getInstrumentVariation("ib", "FN");
+   ASSERT_NE(variation, nullptr);
+   ASSERT_EQ(variation->symbol, "EUR");
+   ASSERT_EQ(variation->factor, 100.0);
+
+   HistoricalReplay replay(feed);
+   std::vector<Execution> expected;
+   for (sint run = 0; run < 3; ++run)
+   {
+      Momentum strategy(&replay, 20);
+      replay.subscribe(run == 1 ? "YM" : "ES");
+      replay.start();
+
+      ASSERT_GT(strategy.executions.size(), 0u);
+      if (run == 0) expected = strategy.executions;
+      else if (run == 1)
+      {
+         for (auto & execution : strategy.executions) ASSERT_EQ(execution.symbol, "YM");
+      }
+      else ASSERT_NO_FATAL_FAILURE(expectSameExecutions(strategy.executions, expected));
+      replay.reset();
+   }
+}
+
+TEST(Strategy, Lookback)
+{
+   PinnacleDataFeed feed;
+   feed.configure("pinnacle.sqlite");
+   std::shared_ptr<const MarketData> data(new MarketData(feed, { "ES", "YM" }));
+
+   MarketDataFeed fullFeed(data);
+   HistoricalReplay full(fullFeed);
+   Momentum expected(&full, 20);
+   full.subscribe("ES");
+   full.subscribe("YM");
+   full.start();
+
+   MarketDataFeed boundedFeed(data);
+   HistoricalReplay bounded(boundedFeed);
+   BoundedMomentum strategy(&bounded, 20);
+   ASSERT_EQ(strategy.lookback(), 21);
+   strategy.requireLookback<SMA<10>>();
+   ASSERT_EQ(strategy.lookback(), 21);
+
+   const Symbol es("ES");
+   const std::string spillPath = "feed_dir/lookback.spill";
+   BarSpill & spill = strategy.spillHistory(es, data->bars().front().timespan, spillPath);
+   bounded.subscribe("ES");
+   bounded.subscribe("YM");
+   bounded.start();
+   spill.flush();
+
+   // Same executions, from a fraction of the history
+   ASSERT_GT(expected.executions.size(), 0u);
+   ASSERT_NO_FATAL_FAILURE(expectSameExecutions(strategy.executions, expected.executions));
+   ASSERT_LE(strategy.maxHistory, 42u);
+
+   // The spill and the history are the full history
+   std::vector<Bar> bars;
+   for (auto & bar : data->bars())
+   {
+      if (bar.symbol == es) bars.push_back(bar);
+   }
+   ASSERT_TRUE(strategy.spilled != nullptr);
+   const BarHistory & history = *strategy.spilled;
+
+   {
+      BarSpillReader reader(spillPath);
+      ASSERT_GT(reader.size(), 0u);
+      ASSERT_EQ(reader.size(), spill.records());
+      ASSERT_EQ(reader.size() + history.close.size(), bars.size());
+      for (uint64 ii = 0; ii < reader.size(); ++ii)
+      {
+         ASSERT_EQ(reader[ii].timestamp, bars[ii].timestamp.epochMicroseconds());
+         ASSERT_EQ(reader[ii].close, bars[ii].close);
+      }
+      ASSERT_EQ(history.timestamp[history.timestamp.size() - 1], bars[reader.size()].timestamp);
+      ASSERT_EQ(history.close[0], bars.back().close);
+   }
+   Poco::File(spillPath).remove();
+}
+
+TEST(Sweep, MatchesSingleThreaded)
+{
+   PinnacleDataFeed feed;
+   feed.configure("pinnacle.sqlite");
+   std::shared_ptr<const MarketData> data(new MarketData(feed, { "ES", "YM" }));
+   ASSERT_EQ(data->bars().size(), 4259u + 3111u);
+
+   Sweep<Momentum, sint> parallel(data, 3);
+   Sweep<Momentum, sint> sequential(data, 1);
+   for (sint length = 5; length <= 50; length += 5)
+   {
+      parallel.add(length);
+      sequential.add(length);
+   }
+
+   Sweep<Momentum, sint>::ResultVector results;
+   Sweep<Momentum, sint>::ResultVector expected;
+   parallel.run(results);
+   sequential.run(expected);
+
+   // One result per (run, symbol), in order
+   ASSERT_EQ(results.size(), 20u);
+   ASSERT_EQ(results.size(), expected.size());
+   for (sint ii = 0; ii < results.size(); ++ii)
+   {
+      ASSERT_EQ(results[ii].run, ii/2);
+      ASSERT_EQ(results[ii].symbol, ii % 2 == 0 ? "ES" : "YM");
+      ASSERT_EQ(results[ii].symbol, expected[ii].symbol);
+      ASSERT_EQ(results[ii].all.numTrades, expected[ii].all.numTrades);
+      ASSERT_EQ(results[ii].all.grossProfits, expected[ii].all.grossProfits);
+      ASSERT_EQ(results[ii].all.grossLosses, expected[ii].all.grossLosses);
+      ASSERT_EQ(results[ii].longs.numTrades, results[ii].all.numTrades);
+      ASSERT_GT(results[ii].all.numTrades, 0u);
+   }
+}
+
+TEST(WalkForward, Windows)
+{
+   PinnacleDataFeed feed;
+   feed.configure("pinnacle.sqlite");
+   std::shared_ptr<const MarketData> data(new MarketData(feed, { "ES", "YM" }));
+
+   Timespan inSample(3*365, 0, 0, 0, 0);
+   Timespan outOfSample(365, 0, 0, 0, 0);
+   WalkForward<Momentum, sint> parallel(data, inSample, outOfSample, 3);
+   WalkForward<Momentum, sint> sequential(data, inSample, outOfSample, 1);
+   for (sint length = 5; length <= 50; length += 5)
+   {
+      parallel.add(length);
+      sequential.add(length);
+   }
+
+   WalkForward<Momentum, sint>::WindowVector windows, expectedWindows;
+   NumericIndexer equity, expectedEquity;
+   parallel.run(&TradeSummary::sharpeRatio, windows, equity);
+   sequential.run(&TradeSummary::sharpeRatio, expectedWindows, expectedEquity);
+
+   ASSERT_GT(windows.size(), 5u);
+   ASSERT_EQ(windows.size(), expectedWindows.size());
+   ASSERT_EQ(windows.front().inSampleStart, data->bars().front().timestamp);
+
+   numeric total = 0.0;
+   for (sint ii = 0; ii < windows.size(); ++ii)
+   {
+      const WalkForward<Momentum, sint>::Window & window = windows[ii];
+      ASSERT_EQ(window.best, expectedWindows[ii].best);
+      ASSERT_GE(window.best, 0);
+      ASSERT_LT(window.best, 10);
+      ASSERT_EQ(window.outOfSampleStart, window.inSampleStart + inSample);
+      if (ii > 0) ASSERT_EQ(window.outOfSampleStart, windows[ii - 1].outOfSampleEnd);
+
+      for (sint jj = 0; jj < window.outOfSamplePnl.size(); ++jj)
+      {
+         ASSERT_GE(window.outOfSamplePnl.index[jj], window.outOfSampleStart);
+         ASSERT_LT(window.outOfSamplePnl.index[jj], window.outOfSampleEnd);
+         total += window.outOfSamplePnl.container[jj];
+      }
+   }
+
+   // The equity is the running total of the stitched out-of-sample PnL
+   ASSERT_GT(equity.size(), 0u);
+   ASSERT_EQ(equity.size(), expectedEquity.size());
+   ASSERT_DOUBLE_EQ(equity.container.back(), total);
+   for (sint ii = 1; ii < equity.size(); ++ii) ASSERT_LT(equity.index[ii - 1], equity.index[ii]);
+}
+
+TEST(ShardedReplay, MatchesSingleReplay)
+{
+   PinnacleDataFeed feed;
+   feed.configure("pinnacle.sqlite");
+   std::shared_ptr<const MarketData> data(new MarketData(feed, { "ES", "YM", "JN", "ZO" }));
+
+   MarketDataFeed single(data);
+   Replay<MarketDataFeed, Momentum> replay(single, 20);
+   for (auto & ss : data->symbols()) replay.subscribe(ss);
+   replay.start();
+   const std::vector<Execution> & expected = replay.strategy().executions;
+
+   // Not symbol independent - a single shard
+   ASSERT_EQ((ShardedReplay<Momentum, sint>(data, 20, 3).shards()), 1);
+
+   ShardedReplay<IndependentMomentum, sint> sharded(data, 20, 3);
+   ASSERT_EQ(sharded.shards(), 3);
+   sharded.run();
+
+   const ShardedReplay<IndependentMomentum, sint>::FillVector & fills = sharded.fills();
+   ASSERT_EQ(fills.size(), expected.size());
+   for (sint ii = 0; ii < fills.size(); ++ii)
+   {
+      ASSERT_EQ(fills[ii].execution.symbol, expected[ii].symbol);
+      ASSERT_EQ(fills[ii].execution.timestamp, expected[ii].timestamp);
+      ASSERT_EQ(fills[ii].execution.price, expected[ii].price);
+      ASSERT_EQ(fills[ii].execution.quantity, expected[ii].quantity);
+   }
+
+   ASSERT_NO_FATAL_FAILURE(expectSameTradeStats(sharded.portfolio(), *replay.getPortfolio("default"), data->instruments()));
+}
+
+TEST(Checkpoint, Resume)
+{
+   PinnacleDataFeed feed;
+   feed.configure("pinnacle.sqlite");
+   std::shared_ptr<const MarketData> data(new MarketData(feed, { "ES", "YM" }));
+
+   MarketDataFeed fullFeed(data);
+   HistoricalReplay full(fullFeed);
+   AveragingMomentum expected(&full, 20);
+   full.subscribe("ES");
+   full.subscribe("YM");
+   full.start();
+
+   // Replay the bars up to a date, then save
+   Timestamp cut = Poco::DateTime(2000, 6, 15).timestamp();
+   std::stringstream checkpoint;
+   {
+      MarketDataFeed partialFeed(data);
+      HistoricalReplay partial(partialFeed);
+      AveragingMomentum strategy(&partial, 20);
+      partial.subscribe("ES");
+      partial.subscribe("YM");
+      for (auto & bar : data->bars())
+      {
+         if (bar.timestamp < cut) partialFeed.barEvent(bar);
+      }
+      Checkpoint::save(checkpoint, partial.simulator(), strategy);
+   }
+
+   // Resume over all the bars
+   MarketDataFeed resumedFeed(data);
+   HistoricalReplay resumed(resumedFeed);
+   AveragingMomentum strategy(&resumed, 20);
+   resumed.subscribe("ES");
+   resumed.subscribe("YM");
+   Checkpoint::load(checkpoint, resumed.simulator(), strategy);
+   resumed.start();
+
+   std::vector<Execution> executions;
+   for (auto & ee : expected.executions)
+   {
+      if (ee.timestamp >= cut) executions.push_back(ee);
+   }
+   ASSERT_GT(executions.size(), 0u);
+   ASSERT_NO_FATAL_FAILURE(expectSameExecutions(strategy.executions, executions));
+
+   ASSERT_EQ(strategy.average.size(), expected.average.size());
+   ASSERT_DOUBLE_EQ(strategy.average.get(), expected.average.get());
+
+   ASSERT_NO_FATAL_FAILURE(expectSameTradeStats(*resumed.getPortfolio("default"), *full.getPortfolio("default"), data->instruments()));
+
+   // A truncated checkpoint is rejected
+   std::string bytes = checkpoint.str();
+   std::stringstream truncated(bytes.substr(0, bytes.size() - 16));
+   MarketDataFeed otherFeed(data);
+   HistoricalReplay other(otherFeed);
+   AveragingMomentum otherStrategy(&other, 20);
+   other.subscribe("ES");
+   other.subscribe("YM");
+   ASSERT_THROW(Checkpoint::load(truncated, other.simulator(), otherStrategy), CheckpointException);
+}
@@ -1,8 +1,11 @@
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "Poco/Delegate.h"
 
+#include "tradelib/Indicators.h"
+#include "tradelib/Symbol.h"
 #include "tradelib/Types.h"
 
 using namespace tradelib;
@@ -46,6 +49,16 @@ protected:
    numeric sum_ = 0.0;
 };
 
+class Counter
+{
+public:
+   void onValue(const void * sender, const sint & value) { sum += value; senders.push_back(sender); }
+   void onValueOnly(const sint & value) { sum += 10*value; }
+
+   sint sum = 0;
+   std::vector<const void *> senders;
+};
+
 TEST(Types, RVector)
 {
    tradelib::RVector<sint> v;
@@ -78,4 +91,107 @@ TEST(Types, RVector)
    {
       ASSERT_EQ(rs.sums[ii], v[ii] + v[ii + 1] + v[ii + 2]);
    }
-}
\ No newline at end of file
+}
+
+TEST(Types, RVectorWindow)
+{
+   tradelib::RVector<sint> v;
+   v.setWindow(8);
+   Counter counter;
+   v.valueEvent += Poco::delegate(&counter, &Counter::onValue);
+
+   for (sint ii = 0; ii < 1000; ++ii)
+   {
+      v.push_back(ii);
+      ASSERT_LE(v.size(), 16u);
+      ASSERT_EQ(v.size() + v.dropped(), static_cast<uint64>(ii + 1));
+      for (sint jj = 0; jj < 8 && jj <= ii; ++jj) ASSERT_EQ(v[jj], ii - jj);
+   }
+   ASSERT_EQ(counter.sum, 999*1000/2);
+
+   // The indicators count the dropped values too
+   NumericRVector bounded;
+   NumericRVector unbounded;
+   SMA<5> boundedSma;
+   SMA<5> unboundedSma;
+   bounded.setWindow(8);
+   boundedSma.setWindow(4);
+   bounded.valueEvent += Poco::delegate(&boundedSma, &SMA<5>::onValue);
+   unbounded.valueEvent += Poco::delegate(&unboundedSma, &SMA<5>::onValue);
+   for (sint ii = 0; ii < 100; ++ii)
+   {
+      bounded.push_back(ii % 7);
+      unbounded.push_back(ii % 7);
+      if (ii >= 4) ASSERT_EQ(boundedSma[0], unboundedSma[0]);
+   }
+   ASSERT_LE(boundedSma.values.size(), 8u);
+}
+
+TEST(Types, Symbol)
+{
+   Symbol empty;
+   ASSERT_EQ(empty.id(), 0u);
+   ASSERT_TRUE(empty.empty());
+   ASSERT_EQ(empty.name(), "");
+
+   Symbol es("ES");
+   Symbol es2(std::string("ES"));
+   Symbol ym("YM");
+   ASSERT_EQ(es.id(), es2.id());
+   ASSERT_NE(es.id(), ym.id());
+   ASSERT_TRUE(es == es2);
+   ASSERT_TRUE(es != ym);
+   ASSERT_TRUE(es == "ES");
+   ASSERT_TRUE(std::string("YM") == ym);
+
+   // The names remain available
+   ASSERT_EQ(es.name(), "ES");
+   const std::string & name = ym;
+   ASSERT_EQ(name, "YM");
+}
+
+TEST(Types, Event)
+{
+   Event<const sint> event;
+   ASSERT_TRUE(event.empty());
+
+   // More handlers than fit inline
+   Counter counters[6];
+   for (auto & cc : counters) event.connect<Counter, &Counter::onValue>(&cc);
+   Counter other;
+   event.connect<Counter, &Counter::onValueOnly>(&other);
+
+   // The Poco adapter
+   Counter poco;
+   event += Poco::delegate(&poco, &Counter::onValue);
+
+   sint value = 2;
+   event(&event, value);
+   event(value);
+
+   for (auto & cc : counters)
+   {
+      ASSERT_EQ(cc.sum, 4);
+      ASSERT_EQ(cc.senders.size(), 2u);
+      ASSERT_EQ(cc.senders[0], &event);
+      ASSERT_EQ(cc.senders[1], nullptr);
+   }
+   ASSERT_EQ(other.sum, 40);
+   ASSERT_EQ(poco.sum, 4);
+
+   // Disconnecting keeps the order and the other handlers
+   event.disconnect(&counters[1]);
+   event.disconnect(&other);
+   event(value);
+   ASSERT_EQ(counters[0].sum, 6);
+   ASSERT_EQ(counters[1].sum, 4);
+   ASSERT_EQ(counters[5].sum, 6);
+   ASSERT_EQ(other.sum, 40);
+   ASSERT_EQ(poco.sum, 6);
+
+   event.clear();
+   ASSERT_TRUE(event.empty());
+   event(value);
+   ASSERT_EQ(counters[0].sum, 6);
+   ASSERT_EQ(poco.sum, 6);
+}
@@ -2,18 +2,21 @@
 #define BAR_H
 
 // std headers
+#include <deque>
 #include <limits>
 #include <map>
 #include <string>
 #include <unordered_map>
 
 // tradelib headers
+#include "tradelib/Serialization.h"
+#include "tradelib/Symbol.h"
 #include "tradelib/Types.h"
 
 namespace tradelib {
    class Bar {
    public:
-      std::string symbol;
+      Symbol      symbol;
       Timestamp   timestamp;
       numeric     open;
       numeric     high;
@@ -28,15 +31,15 @@ namespace tradelib {
          : timestamp(TIMESTAMP_MIN), close(NUMERIC_NAN), timespan(1, 0, 0, 0, 0)
       {}
 
-      Bar(const std::string & s, Timestamp t, numeric op, numeric hi, numeric lo, numeric cl, ulong vol)
+      Bar(const Symbol & s, Timestamp t, numeric op, numeric hi, numeric lo, numeric cl, ulong vol)
          : symbol(s), timestamp(t), open(op), high(hi), low(lo), close(cl), volume(vol), interest(ULONG_MAX), last_(false), timespan(1, 0, 0, 0, 0)
       {}
 
-      Bar(const std::string & s, Timestamp t, numeric op, numeric hi, numeric lo, numeric cl, ulong vol, ulong i)
+      Bar(const Symbol & s, Timestamp t, numeric op, numeric hi, numeric lo, numeric cl, ulong vol, ulong i)
          : symbol(s), timestamp(t), open(op), high(hi), low(lo), close(cl), volume(vol), interest(i), last_(false), timespan(1, 0, 0, 0, 0)
       {}
 
-      Bar(const std::string & s, Timestamp t, numeric op, numeric hi, numeric lo, numeric cl)
+      Bar(const Symbol & s, Timestamp t, numeric op, numeric hi, numeric lo, numeric cl)
          : symbol(s), timestamp(t), open(op), high(hi), low(lo), close(cl), volume(ULONG_MAX), interest(ULONG_MAX), last_(false)
       {}
 
@@ -48,6 +51,91 @@ namespace tradelib {
       bool last_;
    };
 
+   /**
+    * @class BarBlock
+    *
+    * @brief A batch of consecutive bars of a single symbol, one vector per field
+    *
+    * Filled by BarReader::nextBatch, the vectors keep their capacity across "clear".
+    */
+   class BarBlock
+   {
+   public:
+      Symbol symbol;
+      TimestampVector timestamp;
+      NumericVector open;
+      NumericVector high;
+      NumericVector low;
+      NumericVector close;
+      std::vector<ulong> volume;
+      std::vector<ulong> interest;
+
+      // "true" if the block ends with the last bar of the feed
+      bool last;
+
+      BarBlock()
+         : last(false)
+      {}
+
+      sint size() const { return static_cast<sint>(timestamp.size()); }
+      bool empty() const { return timestamp.empty(); }
+
+      void clear()
+      {
+         timestamp.resize(0);
+         open.resize(0);
+         high.resize(0);
+         low.resize(0);
+         close.resize(0);
+         volume.resize(0);
+         interest.resize(0);
+         last = false;
+      }
+
+      void reserve(sint n)
+      {
+         timestamp.reserve(n);
+         open.reserve(n);
+         high.reserve(n);
+         low.reserve(n);
+         close.reserve(n);
+         volume.reserve(n);
+         interest.reserve(n);
+      }
+
+      void append(const Bar & bar)
+      {
+         timestamp.push_back(bar.timestamp);
+         open.push_back(bar.open);
+         high.push_back(bar.high);
+         low.push_back(bar.low);
+         close.push_back(bar.close);
+         volume.push_back(bar.volume);
+         interest.push_back(bar.interest);
+         last = bar.isLast();
+      }
+
+      // The ii-th bar of the block
+      Bar bar(sint ii) const
+      {
+         Bar result(symbol, timestamp[ii], open[ii], high[ii], low[ii], close[ii], volume[ii], interest[ii]);
+         result.setLast(last && ii == size() - 1);
+         return result;
+      }
+   };
+
+   class BarHistory;
+
+   // Takes the bars a BarHistory is about to drop, see BarHistory::setSpill and BarSpill
+   class BarHistorySpill
+   {
+   public:
+      virtual ~BarHistorySpill() {}
+
+      // The oldest "count" bars of the history
+      virtual void write(const BarHistory & history, size_t count) = 0;
+   };
+
    class BarHistory
    {
    public:
@@ -61,6 +149,9 @@ namespace tradelib {
 
       void append(const Bar & bar)
       {
+         // The bars about to be dropped go to the spill first
+         if (spill_ != nullptr && timestamp.pendingDrop() > 0) spill_->write(*this, timestamp.pendingDrop());
+
          timestamp.push_back(bar.timestamp);
          open.push_back(bar.open);
          high.push_back(bar.high);
@@ -69,25 +160,105 @@ namespace tradelib {
          volume.push_back(bar.volume);
          interest.push_back(bar.interest);
       }
+
+      // Keeps the last "window" bars at least, see RVector. The indicators attached to the
+      // vectors must not look further back.
+      void setWindow(sint window)
+      {
+         if (spill_ != nullptr && window > 0 && timestamp.size() > static_cast<size_t>(window)) spill_->write(*this, timestamp.size() - window);
+
+         timestamp.setWindow(window);
+         open.setWindow(window);
+         high.setWindow(window);
+         low.setWindow(window);
+         close.setWindow(window);
+         volume.setWindow(window);
+         interest.setWindow(window);
+      }
+
+      // See Checkpoint. Loading doesn't notify the observers of the vectors.
+      void save(Poco::BinaryWriter & writer) const
+      {
+         serialize(writer, timestamp);
+         serialize(writer, open);
+         serialize(writer, high);
+         serialize(writer, low);
+         serialize(writer, close);
+         serialize(writer, volume);
+         serialize(writer, interest);
+      }
+
+      void load(Poco::BinaryReader & reader)
+      {
+         deserialize(reader, timestamp);
+         deserialize(reader, open);
+         deserialize(reader, high);
+         deserialize(reader, low);
+         deserialize(reader, close);
+         deserialize(reader, volume);
+         deserialize(reader, interest);
+      }
+
+      // The bars dropped from now on are written to "spill" (not owned) instead of being lost,
+      // nullptr - just drop them. Use with setWindow above, so the vectors drop together.
+      void setSpill(BarHistorySpill * spill) { spill_ = spill; }
+      BarHistorySpill * spill() const { return spill_; }
+
+   protected:
+      BarHistorySpill * spill_ = nullptr;
    };
 
    template<typename T>
    class BarHierarchy
    {
    public:
-      T * lookup(const std::string & symbol, Timespan timespan)
+      T * lookup(const Symbol & symbol, Timespan timespan)
       {
-         SymbolToTimespanMap::iterator it = symbolToTimespanMap_.find(symbol);
-         if (it == symbolToTimespanMap_.end()) return nullptr;
+         if (symbol.id() >= symbolToTimespanMap_.size()) return nullptr;
+         TimespanMap & timespans = symbolToTimespanMap_[symbol.id()];
 
-         TimespanMap::iterator timespanIt = it->second.find(timespan);
-         if (timespanIt == it->second.end()) return nullptr;
+         typename TimespanMap::iterator timespanIt = timespans.find(timespan);
+         if (timespanIt == timespans.end()) return nullptr;
          return &timespanIt->second;
       }
 
-      T * lookupOrAdd(const std::string & symbol, Timespan timespan)
+      T * lookupOrAdd(const Symbol & symbol, Timespan timespan)
+      {
+         if (symbol.id() >= symbolToTimespanMap_.size()) symbolToTimespanMap_.resize(symbol.id() + 1);
+         return &symbolToTimespanMap_[symbol.id()][timespan];
+      }
+
+      // T must provide "save" and "load". Loading updates the elements in place (adding the
+      // missing ones), so the pointers handed out before remain valid.
+      void save(Poco::BinaryWriter & writer) const
+      {
+         Poco::UInt32 count = 0;
+         for (auto & timespans : symbolToTimespanMap_) count += static_cast<Poco::UInt32>(timespans.size());
+
+         writer << count;
+         for (sint ii = 0; ii < symbolToTimespanMap_.size(); ++ii)
+         {
+            for (auto & tt : symbolToTimespanMap_[ii])
+            {
+               writer << SymbolTable::instance().name(static_cast<uint32>(ii));
+               serialize(writer, tt.first);
+               tt.second.save(writer);
+            }
+         }
+      }
+
+      void load(Poco::BinaryReader & reader)
       {
-         return &symbolToTimespanMap_[symbol][timespan];
+         Poco::UInt32 count = 0;
+         reader >> count;
+         for (Poco::UInt32 ii = 0; ii < count && reader.good(); ++ii)
+         {
+            Symbol symbol;
+            Timespan timespan;
+            deserialize(reader, symbol);
+            deserialize(reader, timespan);
+            lookupOrAdd(symbol, timespan)->load(reader);
+         }
       }
 
    protected:
@@ -96,7 +267,8 @@ namespace tradelib {
          size_t operator()(const Timespan & timespan) { return (size_t)timespan.milliseconds(); }
       };
       typedef std::unordered_map<Timespan, T, TimespanIdentity> TimespanMap;
-      typedef std::unordered_map<std::string, TimespanMap> SymbolToTimespanMap;
+      // Indexed by the symbol id. A deque, so that growing it doesn't move the elements.
+      typedef std::deque<TimespanMap> SymbolToTimespanMap;
 
       SymbolToTimespanMap symbolToTimespanMap_;
    };
@@ -0,0 +1,117 @@
+#ifndef BAR_CACHE_H
+#define BAR_CACHE_H
+
+// std headers
+#include <string>
+
+// libraries headers
+#include "Poco/Exception.h"
+#include "Poco/SharedMemory.h"
+
+// tradelib headers
+#include "tradelib/BarReader.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class BarCacheHeader
+    *
+    * @brief The header of a bar cache file
+    *
+    * A bar cache file is the binary, columnar image of a bar file (CSV). The header is followed
+    * by seven columns of "rows" elements each, in this order:
+    *
+    *    timestamp (sint64, epoch microseconds), open, high, low, close (numeric),
+    *    volume, interest (uint64)
+    *
+    * The header is 8-byte aligned, so are all columns (see BinaryFile for the byte order). The
+    * checksum is the CRC32 of all columns. The source size and modification time identify the
+    * CSV the cache was built from, and the format checksum the date format it was parsed with -
+    * a cache is "fresh" as long as they match the CSV on disk and the configured format.
+    */
+   class BarCacheHeader
+   {
+   public:
+      static const uint32 MAGIC = 0x43424c54; // "TLBC" in little endian
+      static const uint32 VERSION = 2;
+      static const uint32 MAX_SYMBOL_LENGTH = 31;
+
+      uint32 magic;
+      uint32 version;
+      char symbol[MAX_SYMBOL_LENGTH + 1];
+      uint64 rows;
+      sint64 sourceSize;
+      sint64 sourceModified;
+      uint32 checksum;
+      uint32 formatChecksum;
+   };
+
+   /**
+    * @class BarCache
+    *
+    * @brief Builds and validates bar cache files
+    *
+    * The cache for a bar file lives next to it: "ES_REV.CSV" is cached in "ES_REV.CSV.barcache".
+    */
+   class BarCache
+   {
+   public:
+      static const std::string SUFFIX;
+
+      static std::string cachePath(const std::string & csvPath) { return csvPath + SUFFIX; }
+
+      // Parses the CSV and writes its cache (replacing any existing one)
+      static void convert(const std::string & symbol, const std::string & csvPath, const std::string & format);
+
+      // "true" if the cache exists and was built from the current version of the CSV, with the
+      // same date format
+      static bool isFresh(const std::string & csvPath, const std::string & format);
+
+      // The CRC32 of a date format, identifies the parse settings of the cache and the index
+      static uint32 formatChecksum(const std::string & format);
+   };
+
+   /**
+    * @class BarCacheReader
+    *
+    * @brief Reads the bars from a cache file
+    *
+    * The file is memory mapped, decoding a bar is a handful of loads from the columns.
+    * The constructor validates the file (including the checksum) and throws BarCacheException
+    * if anything is wrong.
+    */
+   class BarCacheReader : public BarReader
+   {
+   public:
+      BarCacheReader(const std::string & symbol, const std::string & cachePath);
+
+      // Copies straight from the columns
+      virtual sint nextBatch(BarBlock & block, sint maxBars);
+
+      // A binary search in the timestamp column
+      virtual void setRange(Timestamp start, Timestamp end);
+
+   protected:
+      virtual void readBars();
+      virtual bool exhausted() const { return row_ == rows_; }
+
+      Poco::SharedMemory mapping_;
+
+      const sint64 * timestamp_;
+      const numeric * open_;
+      const numeric * high_;
+      const numeric * low_;
+      const numeric * close_;
+      const uint64 * volume_;
+      const uint64 * interest_;
+
+      // The next row and the end of the rows to read
+      uint64 rows_;
+      uint64 row_;
+   };
+
+   POCO_DECLARE_EXCEPTION(, BarCacheException, Poco::Exception)
+}
+
+#endif // BAR_CACHE_H
@@ -2,104 +2,76 @@
 #define BAR_FILE_READER_H
 
 // std headers
-#include <fstream>
-#include <memory>
-#include <queue>
 #include <string>
 
 // libraries headers
 #include "Poco/String.h"
-#include "Poco/DateTimeParser.h"
 
 // tradelib headers
 #include "tradelib/Bar.h"
+#include "tradelib/BarReader.h"
 #include "tradelib/CsvReader.h"
+#include "tradelib/DateParser.h"
+#include "tradelib/NumberParser.h"
 
 namespace tradelib
 {
-   class BarFileReader
+   class BarFileReader : public BarReader
    {
    public:
-      explicit BarFileReader(const std::string & symbol, const std::string & path, const std::string & format)
-         : symbol_(symbol), stream_(new std::ifstream(path)), csvReader_(stream_.get()), format_(format)
+      // The file is memory mapped and parsed in place (see CsvReader)
+      explicit BarFileReader(const Symbol & symbol, const std::string & path, const std::string & format)
+         : BarReader(symbol), csvReader_(path), dateParser_(format), done_(false)
       {}
 
-      explicit BarFileReader(const std::string & symbol, const std::string & path)
-         : symbol_(symbol), stream_(new std::ifstream(path)), csvReader_(stream_.get())
-      {}
-
-      explicit BarFileReader(const BarFileReader & other)
-         : stream_(other.stream_.release()), csvReader_(other.csvReader_), symbol_(other.symbol_), buffer_(other.buffer_), format_(other.format_)
+      explicit BarFileReader(const Symbol & symbol, const std::string & path)
+         : BarReader(symbol), csvReader_(path), done_(false)
       {}
 
       BarFileReader()
+         : done_(false)
       {}
 
-      BarFileReader & operator=(const BarFileReader & other)
-      {
-         stream_.reset(other.stream_.release());
-         csvReader_ = other.csvReader_;
-         symbol_ = other.symbol_;
-         buffer_ = other.buffer_;
-         format_ = other.format_;
-         return *this;
-      }
-
-      bool next(Bar & bar) { return getBar(bar, true); }
-      bool peek(Bar & bar) { return getBar(bar, false); }
-
-      bool eof() const { return buffer_.empty() && csvReader_.eof(); }
-
-      const std::string & symbol() const { return symbol_; }
+      // Continues reading at the row at "offset" (see BarIndex). Uncompressed files only.
+      void seek(uint64 offset) { csvReader_.seek(static_cast<size_t>(offset)); }
 
    protected:
-      void readBars()
+      virtual void readBars()
       {
-         std::vector<std::string> columns;
-         while (!csvReader_.eof() && buffer_.size() < CACHE_SIZE && csvReader_.next(columns))
+         while (!done_ && !csvReader_.eof() && !buffer_.full() && csvReader_.next(fields_))
          {
-            int tzd;
             // date
-            tradelib::Timestamp timestamp = format_.length() > 0 ? Poco::DateTimeParser::parse(format_, columns[0], tzd).timestamp() : Poco::DateTimeParser::parse(columns[0], tzd).timestamp();
-            numeric op = std::stod(columns[1]);
-            numeric hi = std::stod(columns[2]);
-            numeric lo = std::stod(columns[3]);
-            numeric cl = std::stod(columns[4]);
-            ulong vol = (columns.size() > 5) ? std::stol(columns[5]) : 0L;
-            ulong interest = (columns.size() > 6) ? std::stol(columns[6]) : 0L;
-
-            buffer_.emplace(symbol_, timestamp, op, hi, lo, cl, vol);
+            tradelib::Timestamp timestamp = dateParser_.parse(fields_[0].begin(), fields_[0].end());
+
+            // Skip the rows before the range, stop at the first one after it
+            if (timestamp < start_) continue;
+            if (timestamp >= end_)
+            {
+               done_ = true;
+               break;
+            }
+            numeric op = NumberParser::parseNumeric(fields_[1].begin(), fields_[1].end());
+            numeric hi = NumberParser::parseNumeric(fields_[2].begin(), fields_[2].end());
+            numeric lo = NumberParser::parseNumeric(fields_[3].begin(), fields_[3].end());
+            numeric cl = NumberParser::parseNumeric(fields_[4].begin(), fields_[4].end());
+            ulong vol = (fields_.size() > 5) ? NumberParser::parseLong(fields_[5].begin(), fields_[5].end()) : 0L;
+            ulong interest = (fields_.size() > 6) ? NumberParser::parseLong(fields_[6].begin(), fields_[6].end()) : 0L;
+
+            buffer_.emplace(symbol_, timestamp, op, hi, lo, cl, vol, interest);
          }
       }
 
-      bool getBar(Bar & bar, bool popIt)
-      {
-         // Cache some bars
-         if (buffer_.size() < 2) readBars();
-
-         // Done when the buffer is empty
-         if (buffer_.empty()) return false;
-
-         // Pop a bar
-         bar = buffer_.front();
-         if (popIt) buffer_.pop();
-
-         // Mark the last bar of the file
-         if (buffer_.size() == 0) bar.setLast(true);
+      virtual bool exhausted() const { return done_ || csvReader_.eof(); }
 
-         return true;
-      }
+      CsvReader csvReader_;
+      // The fields of the current line, reused to avoid allocations
+      CsvFieldVector fields_;
 
-      static const sint CACHE_SIZE = 16;
-      poco_static_assert(CACHE_SIZE > 1);
+      DateParser dateParser_;
 
-      mutable std::unique_ptr<std::ifstream> stream_;
-      CsvReader csvReader_;
-      
-      std::string symbol_;
-      std::queue<Bar> buffer_;
-      std::string format_;
+      // Past the end of the range
+      bool done_;
    };
 }
 
-#endif // CSV_BAR_READER_H
\ No newline at end of file
+#endif // BAR_FILE_READER_H
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef BAR_INDEX_H
+#define BAR_INDEX_H
+
+// std headers
+#include <string>
+#include <vector>
+
+// libraries headers
+#include "Poco/Exception.h"
+
+// tradelib headers
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class BarIndexHeader
+    *
+    * @brief The header of a bar index file
+    *
+    * A bar index is a sidecar of a bar file (CSV) with the byte offset of the first row of
+    * every month. The header is followed by "entries" pairs of (timestamp, offset), see
+    * BinaryFile for the byte order. Like the bar cache, the index is "fresh" as long as the source size
+    * and modification time match the CSV on disk, and the format checksum the configured date
+    * format (see BarCache::formatChecksum).
+    */
+   class BarIndexHeader
+   {
+   public:
+      static const uint32 MAGIC = 0x49424c54; // "TLBI" in little endian
+      static const uint32 VERSION = 2;
+
+      uint32 magic;
+      uint32 version;
+      uint64 entries;
+      sint64 sourceSize;
+      sint64 sourceModified;
+      uint32 formatChecksum;
+      uint32 reserved;
+   };
+
+   /**
+    * @class BarIndex
+    *
+    * @brief Seeking by time in bar files
+    *
+    * The index for "ES_REV.CSV" lives in "ES_REV.CSV.idx". Only plain (uncompressed) files
+    * can be indexed, the offsets are those of the mapped file (see CsvReader).
+    */
+   class BarIndex
+   {
+   public:
+      static const std::string SUFFIX;
+
+      static std::string indexPath(const std::string & csvPath) { return csvPath + SUFFIX; }
+
+      // Scans the CSV and writes its index (replacing any existing one)
+      static void build(const std::string & csvPath, const std::string & format);
+
+      // "true" if the index exists and was built from the current version of the CSV, with the
+      // same date format
+      static bool isFresh(const std::string & csvPath, const std::string & format);
+
+      // Loads an index, throws BarIndexException if the file is damaged
+      explicit BarIndex(const std::string & indexPath);
+
+      // The offset of a row at or before the first one with a timestamp of at least "start"
+      uint64 offset(Timestamp start) const;
+
+   protected:
+      class Entry
+      {
+      public:
+         sint64 timestamp;
+         uint64 offset;
+      };
+
+      std::vector<Entry> entries_;
+   };
+
+   POCO_DECLARE_EXCEPTION(, BarIndexException, Poco::Exception)
+}
+
+#endif // BAR_INDEX_H
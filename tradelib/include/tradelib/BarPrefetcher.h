@@ -0,0 +1,99 @@
+#ifndef BAR_PREFETCHER_H
+#define BAR_PREFETCHER_H
+
+// std headers
+#include <deque>
+#include <exception>
+#include <memory>
+#include <vector>
+
+// libraries headers
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+
+// tradelib headers
+#include "tradelib/Bar.h"
+#include "tradelib/BarReader.h"
+
+namespace tradelib
+{
+   /**
+    * @class BarPrefetcher
+    *
+    * @brief Decodes bar files in the background
+    *
+    * Each source reader gets a bounded queue of up to "depth" decoded bars. A pool of worker
+    * threads keeps the queues filled, in chunks of CHUNK_SIZE bars, while the replay thread
+    * consumes them through the readers returned by "prefetch". A source is only ever decoded
+    * by one worker at a time, and a full queue is not scheduled until the consumer drains it
+    * to half its depth, so memory stays bounded regardless of how far apart the symbols are.
+    *
+    * Errors thrown by a source are rethrown on the replay thread when its queue runs dry.
+    *
+    * The sources must outlive the prefetcher. The destructor stops and joins the workers,
+    * the bars still queued are lost (the sources have moved past them).
+    */
+   class BarPrefetcher : protected Poco::Runnable
+   {
+   public:
+      BarPrefetcher(sint threads, sint depth);
+      virtual ~BarPrefetcher();
+
+      // The returned reader delivers the bars of "source". Call before "start".
+      std::unique_ptr<BarReader> prefetch(BarReader & source);
+
+      void start();
+      void stop();
+
+   protected:
+      static const sint CHUNK_SIZE = 64;
+
+      class Queue
+      {
+      public:
+         explicit Queue(BarReader & source)
+            : source(source), scheduled(false), done(false)
+         {}
+
+         BarReader & source;
+         std::deque<Bar> bars;
+         // Sitting in the work queue or being decoded by a worker
+         bool scheduled;
+         // The source is exhausted (or failed)
+         bool done;
+         std::exception_ptr error;
+      };
+
+      class Reader;
+      friend class Reader;
+
+      virtual void run();
+
+      // Called by the readers on the replay thread. Fills "buffer" up to "capacity" bars,
+      // waiting for the workers until it holds at least two or the source is exhausted.
+      void take(Queue & queue, BarReader::BarRing & buffer, sint capacity);
+      bool exhausted(Queue & queue);
+
+      // Requires mutex_
+      void schedule(Queue & queue);
+
+      sint depth_;
+      bool stopping_;
+
+      // Stable addresses - the readers and the work queue point into it
+      std::deque<Queue> queues_;
+      std::deque<Queue *> work_;
+
+      std::vector<std::unique_ptr<Poco::Thread>> threads_;
+
+      Poco::FastMutex mutex_;
+      // Signalled when work_ gets an entry (or on stop)
+      Poco::Condition workAvailable_;
+      // Signalled when a queue gets bars (or is done)
+      Poco::Condition barsAvailable_;
+   };
+}
+
+#endif // BAR_PREFETCHER_H
@@ -0,0 +1,134 @@
+#ifndef BAR_READER_H
+#define BAR_READER_H
+
+// std headers
+#include <string>
+
+// tradelib headers
+#include "tradelib/Bar.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class BarReader
+    *
+    * @brief The base class for the per-symbol bar sources of the historical feeds
+    *
+    * Bars are decoded in small chunks (up to CACHE_SIZE) into a ring buffer by the
+    * implementation (readBars), the base class takes care of "next"/"peek", the batches
+    * and of marking the last bar.
+    *
+    * The pointer versions of "next" and "peek" return the bar in place, it remains valid
+    * until the next call on the reader. The reference versions copy it out.
+    */
+   class BarReader
+   {
+   public:
+      static const sint CACHE_SIZE = 16;
+      typedef RingBuffer<Bar, CACHE_SIZE> BarRing;
+
+      explicit BarReader(const Symbol & symbol)
+         : symbol_(symbol), start_(TIMESTAMP_MIN), end_(TIMESTAMP_MAX)
+      {}
+
+      BarReader()
+         : start_(TIMESTAMP_MIN), end_(TIMESTAMP_MAX)
+      {}
+
+      virtual ~BarReader() {}
+
+      // The next bar, nullptr at the end of the data
+      const Bar * next()
+      {
+         fill();
+
+         // Done when the buffer is empty
+         if (buffer_.empty()) return nullptr;
+
+         // The slot isn't reused before the next call
+         Bar * bar = &buffer_.front();
+         buffer_.pop();
+
+         // Mark the last bar of the file
+         if (buffer_.empty()) bar->setLast(true);
+
+         return bar;
+      }
+
+      const Bar * peek()
+      {
+         fill();
+         return buffer_.empty() ? nullptr : &buffer_.front();
+      }
+
+      bool next(Bar & bar)
+      {
+         const Bar * next = this->next();
+         if (next == nullptr) return false;
+         bar = *next;
+         return true;
+      }
+
+      bool peek(Bar & bar)
+      {
+         const Bar * next = peek();
+         if (next == nullptr) return false;
+         bar = *next;
+         return true;
+      }
+
+      // The timestamp of the next bar, without copying the bar
+      bool peekTimestamp(Timestamp & timestamp)
+      {
+         const Bar * next = peek();
+         if (next == nullptr) return false;
+         timestamp = next->timestamp;
+         return true;
+      }
+
+      // Appends up to "maxBars" bars to the block, returns the number of bars appended
+      virtual sint nextBatch(BarBlock & block, sint maxBars)
+      {
+         block.symbol = symbol_;
+
+         sint count = 0;
+         for (const Bar * bar; count < maxBars && (bar = next()) != nullptr; ++count) block.append(*bar);
+         return count;
+      }
+
+      // Restricts the bars to [start, end). Must be called before reading.
+      virtual void setRange(Timestamp start, Timestamp end)
+      {
+         start_ = start;
+         end_ = end;
+      }
+
+      bool eof() const { return buffer_.empty() && exhausted(); }
+
+      const Symbol & symbol() const { return symbol_; }
+
+   protected:
+      // Decode bars into buffer_, until it's full or the source is exhausted
+      virtual void readBars() = 0;
+      // "true" when the source has nothing more to decode
+      virtual bool exhausted() const = 0;
+
+      // Keeps at least two bars buffered, so that the last one can be recognized
+      void fill()
+      {
+         if (buffer_.size() < 2) readBars();
+      }
+
+      poco_static_assert(CACHE_SIZE > 1);
+
+      Symbol symbol_;
+      BarRing buffer_;
+
+      // The range of the bars, see setRange
+      Timestamp start_;
+      Timestamp end_;
+   };
+}
+
+#endif // BAR_READER_H
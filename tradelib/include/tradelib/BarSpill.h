@@ -0,0 +1,112 @@
+#ifndef BAR_SPILL_H
+#define BAR_SPILL_H
+
+// std headers
+#include <string>
+
+// libraries headers
+#include "Poco/Exception.h"
+#include "Poco/FileStream.h"
+#include "Poco/SharedMemory.h"
+
+// tradelib headers
+#include "tradelib/Bar.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class BarSpillHeader
+    *
+    * @brief The header of a bar spill file
+    *
+    * A spill is the header followed by the bars dropped from a history (BarSpillRecord),
+    * oldest first. The record count follows from the file size. See BinaryFile for the byte
+    * order.
+    */
+   class BarSpillHeader
+   {
+   public:
+      static const uint32 MAGIC = 0x50534c54; // "TLSP" in little endian
+      static const uint32 VERSION = 1;
+
+      uint32 magic;
+      uint32 version;
+   };
+
+   class BarSpillRecord
+   {
+   public:
+      sint64 timestamp;
+      numeric open;
+      numeric high;
+      numeric low;
+      numeric close;
+      sint64 volume;
+      sint64 interest;
+   };
+
+   /**
+    * @class BarSpill
+    *
+    * @brief Keeps the bars a bounded history drops
+    *
+    * A BarHistory with a window (see BarHistory::setWindow) keeps the recent bars only. The
+    * analytics needing the full history set a spill on it (BarHistory::setSpill): the bars are
+    * appended to the file as the history drops them, in blocks of half its size. The spilled
+    * bars followed by the ones in the history are the full history. Read them with
+    * BarSpillReader, after a "flush".
+    */
+   class BarSpill : public BarHistorySpill
+   {
+   public:
+      // Replaces an existing file
+      explicit BarSpill(const std::string & path);
+
+      BarSpill(const BarSpill &) = delete;
+      BarSpill & operator=(const BarSpill &) = delete;
+
+      // Appends the oldest "count" bars of the history
+      virtual void write(const BarHistory & history, size_t count);
+      void flush();
+
+      const std::string & path() const { return path_; }
+      uint64 records() const { return records_; }
+
+   protected:
+      std::string path_;
+      Poco::FileOutputStream os_;
+      uint64 records_;
+   };
+
+   /**
+    * @class BarSpillReader
+    *
+    * @brief Maps a bar spill
+    *
+    * The records are read in place, straight from the mapping. Sees the records flushed
+    * before it was constructed.
+    */
+   class BarSpillReader
+   {
+   public:
+      explicit BarSpillReader(const std::string & path);
+
+      BarSpillReader(const BarSpillReader &) = delete;
+      BarSpillReader & operator=(const BarSpillReader &) = delete;
+
+      uint64 size() const { return size_; }
+
+      // Oldest first, unlike the RVector of the history
+      const BarSpillRecord & operator[](uint64 ii) const { return records_[ii]; }
+
+   protected:
+      Poco::SharedMemory mapping_;
+      const BarSpillRecord * records_;
+      uint64 size_;
+   };
+
+   POCO_DECLARE_EXCEPTION(, BarSpillException, Poco::Exception)
+}
+
+#endif // BAR_SPILL_H
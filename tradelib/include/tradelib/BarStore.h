@@ -0,0 +1,132 @@
+#ifndef BAR_STORE_H
+#define BAR_STORE_H
+
+// std headers
+#include <string>
+#include <vector>
+
+// libraries headers
+#include "Poco/Exception.h"
+#include "Poco/SharedMemory.h"
+
+// tradelib headers
+#include "tradelib/Bar.h"
+#include "tradelib/InstrumentRecord.h"
+#include "tradelib/MarketData.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class BarStoreHeader
+    *
+    * @brief The header of a bar store file
+    *
+    * A bar store is the decoded image of a MarketData: the header, "instruments" instrument
+    * records (InstrumentRecord), "variations" instrument variation records
+    * (InstrumentVariationRecord) and eight columns of "rows" elements each, in this order:
+    *
+    *    timestamp (sint64, epoch microseconds), open, high, low, close (numeric),
+    *    volume, interest (uint64), instrument (uint32, the index of the instrument record)
+    *
+    * The rows are in the order of the MarketData bars (timestamp order). Everything is 8-byte
+    * aligned, see BinaryFile for the byte order.
+    */
+   class BarStoreHeader
+   {
+   public:
+      static const uint32 MAGIC = 0x53424c54; // "TLBS" in little endian
+      static const uint32 VERSION = 2;
+
+      uint32 magic;
+      uint32 version;
+      uint32 instruments;
+      uint32 variations;
+      uint64 rows;
+   };
+
+   /**
+    * @class BarStore
+    *
+    * @brief Publishes market data for other processes
+    *
+    * The processes running backtests over the same universe attach to a single store (see
+    * BarStoreFeed) instead of parsing the bar files each. The store is mapped read-only, so
+    * they all share one copy of it in the page cache. Put it on a memory file system (i.e.
+    * /dev/shm) to keep it off the disk altogether.
+    */
+   class BarStore
+   {
+   public:
+      // A process attaching meanwhile sees either the previous store or the new one, never a
+      // partial one (see BinaryFile)
+      static void publish(const MarketData & data, const std::string & path);
+   };
+
+   /**
+    * @class BarStoreFeed
+    *
+    * @brief Replays a bar store
+    *
+    * Attaching maps the store and validates the header, the size and the instrument column -
+    * the price columns are only read by the replay. The instruments and the instrument
+    * variations come from the store.
+    * Replays the bars of the subscribed symbols, like MarketDataFeed.
+    */
+   class BarStoreFeed : public InstrumentRecordFeed
+   {
+   public:
+      explicit BarStoreFeed(const std::string & path);
+
+      BarStoreFeed(const BarStoreFeed &) = delete;
+      BarStoreFeed & operator=(const BarStoreFeed &) = delete;
+
+      virtual void start();
+
+      // Same as "start", but the bars go straight to "handler.onBar(const Bar & bar)"
+      template<class Handler>
+      void run(Handler & handler)
+      {
+         uint64 end = subscribedEnd();
+         for (uint64 ii = 0; ii < end; ++ii)
+         {
+            if (subscribed_[instrument_[ii]]) handler.onBar(bar(ii, ii == end - 1));
+         }
+      }
+
+      uint64 rows() const { return rows_; }
+
+   protected:
+      Bar bar(uint64 ii, bool last) const
+      {
+         Bar result(symbols_[instrument_[ii]], Timestamp(timestamp_[ii]), open_[ii], high_[ii], low_[ii], close_[ii],
+                    static_cast<ulong>(volume_[ii]), static_cast<ulong>(interest_[ii]));
+         result.setLast(last);
+         return result;
+      }
+
+      // Past the last row of the subscribed symbols, the replay ends there and flags it last
+      uint64 subscribedEnd() const
+      {
+         uint64 end = rows_;
+         while (end > 0 && !subscribed_[instrument_[end - 1]]) --end;
+         return end;
+      }
+
+      Poco::SharedMemory mapping_;
+
+      const sint64 * timestamp_;
+      const numeric * open_;
+      const numeric * high_;
+      const numeric * low_;
+      const numeric * close_;
+      const uint64 * volume_;
+      const uint64 * interest_;
+      const uint32 * instrument_;
+      uint64 rows_;
+   };
+
+   POCO_DECLARE_EXCEPTION(, BarStoreException, Poco::Exception)
+}
+
+#endif // BAR_STORE_H
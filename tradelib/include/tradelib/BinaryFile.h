@@ -0,0 +1,83 @@
+#ifndef BINARY_FILE_H
+#define BINARY_FILE_H
+
+// std headers
+#include <ostream>
+#include <string>
+
+// libraries headers
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+
+// tradelib headers
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class BinaryFile
+    *
+    * @brief The rules shared by the binary files (checkpoints, traces, bar caches and indexes,
+    * bar stores, spills and event logs)
+    *
+    * A file starts with its 32-bit magic and version. The files are read back on the machine
+    * which wrote them, so the values are stored in the native byte order, as they are in
+    * memory. On a platform with the other byte order the magic reads swapped, the file is
+    * rejected (see "check") instead of being misread.
+    *
+    * A file is replaced atomically (see "write"): a reader opening it meanwhile sees either
+    * the previous file or the new one, never a partial one.
+    */
+   class BinaryFile
+   {
+   public:
+      // Calls "writer(std::ostream & os)" on a temporary file next to "path", then renames it
+      // to "path". Throws Exception if the stream fails. The temporary file doesn't outlive
+      // a failure, an existing file is left as it was.
+      template<class Exception, class Writer>
+      static void write(const std::string & path, Writer writer)
+      {
+         std::string tmpPath = path + ".tmp";
+         try
+         {
+            {
+               Poco::FileOutputStream os(tmpPath, std::ios::out | std::ios::trunc | std::ios::binary);
+               writer(os);
+               os.flush();
+               if (!os.good()) throw Exception("Failed to write " + tmpPath);
+            }
+            Poco::File(tmpPath).renameTo(path);
+         }
+         catch (...)
+         {
+            remove(tmpPath);
+            throw;
+         }
+      }
+
+      // Whether the magic and the version read from a file are the expected ones
+      static bool matches(uint32 magic, uint32 version, uint32 expectedMagic, uint32 expectedVersion)
+      {
+         return magic == expectedMagic && version == expectedVersion;
+      }
+
+      // Throws Exception if they are not. "what" names the file (i.e. its path) in the message,
+      // unless empty (i.e. when reading a stream)
+      template<class Exception>
+      static void check(uint32 magic, uint32 version, uint32 expectedMagic, uint32 expectedVersion, const std::string & what)
+      {
+         if (magic != expectedMagic) throw Exception(mismatch(magic, expectedMagic, what));
+         if (version != expectedVersion) throw Exception(unsupported(version, what));
+      }
+
+   private:
+      // Removes a file if it exists, ignoring the errors
+      static void remove(const std::string & path);
+
+      // The message of a magic mismatch, it tells the other byte order apart
+      static std::string mismatch(uint32 magic, uint32 expectedMagic, const std::string & what);
+      static std::string unsupported(uint32 version, const std::string & what);
+   };
+}
+
+#endif // BINARY_FILE_H
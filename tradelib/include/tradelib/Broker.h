@@ -7,11 +7,9 @@
 #include <list>
 #include <vector>
 
-// libraries headers
-#include "Poco/BasicEvent.h"
-
 // tradelib headers
 #include "tradelib/Bar.h"
+#include "tradelib/Event.h"
 #include "tradelib/Instrument.h"
 #include "tradelib/Order.h"
 #include "tradelib/Portfolio.h"
@@ -22,10 +20,10 @@ namespace tradelib
    class Broker
    {
    public:
-      Poco::BasicEvent<const Bar> barOpenEvent;
-      Poco::BasicEvent<const Bar> barCloseEvent;
-      Poco::BasicEvent<const Bar> barClosedEvent;
-      Poco::BasicEvent<const OrderNotification> orderNotificationEvent;
+      Event<const Bar> barOpenEvent;
+      Event<const Bar> barCloseEvent;
+      Event<const Bar> barClosedEvent;
+      Event<const OrderNotification> orderNotificationEvent;
 
       class InstrumentPosition
       {
@@ -41,9 +39,29 @@ namespace tradelib
       virtual void start() = 0;
       virtual void subscribe(const std::string & symbol) = 0;
       virtual void unsubscribe(const std::string & symbol) {}
-      virtual void submitOrder(const Order & order) = 0;
+      // The handle identifies the order until it is filled, cancelled or expires
+      virtual OrderHandle submitOrder(const Order & order) = 0;
+      // "false" if the order is no longer active (or the broker doesn't support it)
+      virtual bool cancelOrder(OrderHandle handle) { return false; }
+      // Moves the price of an active order (see Order::setTriggerPrice)
+      virtual bool modifyOrder(OrderHandle handle, numeric price) { return false; }
+      // Order groups, see FillSimulator::submitOco and submitBracket
+      virtual void submitOco(const Order & first, const Order & second, OrderHandle & firstHandle, OrderHandle & secondHandle)
+      {
+         throw Poco::NotImplementedException("submitOco");
+      }
+      virtual void submitBracket(
+               const Order & entry,
+               const Order & target,
+               const Order & stop,
+               OrderHandle & entryHandle,
+               OrderHandle & targetHandle,
+               OrderHandle & stopHandle)
+      {
+         throw Poco::NotImplementedException("submitBracket");
+      }
       virtual const Instrument * getInstrument(const std::string & symbol) = 0;
-      virtual const InstrumentPosition * getInstrumentPosition(const std::string & symbol) = 0;
+      virtual const InstrumentPosition * getInstrumentPosition(const Symbol & symbol) = 0;
       virtual const InstrumentVariation * getInstrumentVariation(const std::string & provider, const std::string & symbol) { return nullptr; }
       // Resets all runtime data, but leaves the configuration
       virtual void reset() {}
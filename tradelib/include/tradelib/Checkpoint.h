@@ -0,0 +1,62 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+// std headers
+#include <iosfwd>
+#include <string>
+
+// libraries headers
+#include "Poco/Exception.h"
+
+// tradelib headers
+#include "tradelib/FillSimulator.h"
+#include "tradelib/Strategy.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class Checkpoint
+    *
+    * @brief The state of a replay, saved to resume it later
+    *
+    * A checkpoint holds the fill simulator (positions, active orders and the portfolio) and
+    * the strategy (bar histories and the state saved by Strategy::saveState, i.e. indicators).
+    * When the data is extended (i.e. a day appended to every file), the replay is resumed
+    * from the checkpoint instead of being re-run from the beginning:
+    *
+    *    HistoricalReplay replay(feed);
+    *    MyStrategy strategy(&replay);
+    *    replay.subscribe("ES");
+    *    Checkpoint::load(path, replay.simulator(), strategy);
+    *    replay.start();
+    *    Checkpoint::save(path, replay.simulator(), strategy);
+    *
+    * After the load, the bars up to the last one each symbol processed are skipped without
+    * reaching the strategy. Setting the feed's start date close to the checkpoint (i.e.
+    * PinnacleDataFeed's "start_date") avoids reading them too.
+    *
+    * The checkpoint is taken between runs - after "start" returns. The strategy must be
+    * constructed with the same parameters and the symbols subscribed before the load. See
+    * BinaryFile for the byte order.
+    */
+   class Checkpoint
+   {
+   public:
+      static const uint32 MAGIC = 0x50434c54; // "TLCP" in little endian
+      // 2: bracket and one-cancels-other groups, 3: bounded histories, 4: order handles
+      static const uint32 VERSION = 4;
+
+      // An existing checkpoint is replaced only once the new one is complete (see BinaryFile)
+      static void save(const std::string & path, const FillSimulator & simulator, const Strategy & strategy);
+      // Throws CheckpointException if the file is not a checkpoint, or is truncated
+      static void load(const std::string & path, FillSimulator & simulator, Strategy & strategy);
+
+      static void save(std::ostream & os, const FillSimulator & simulator, const Strategy & strategy);
+      static void load(std::istream & is, FillSimulator & simulator, Strategy & strategy);
+   };
+
+   POCO_DECLARE_EXCEPTION(, CheckpointException, Poco::Exception)
+}
+
+#endif // CHECKPOINT_H
@@ -2,12 +2,17 @@
 #define CSV_READER_H
 
 // std headers
+#include <cstring>
 #include <istream>
+#include <memory>
 #include <string>
 #include <vector>
 
 // libraries headers
 #include "Poco/Exception.h"
+#include "Poco/FileStream.h"
+#include "Poco/InflatingStream.h"
+#include "Poco/SharedMemory.h"
 #include "Poco/String.h"
 #include "Poco/StringTokenizer.h"
 
@@ -16,27 +21,115 @@
 
 namespace tradelib
 {
+   /**
+    * @class CsvField
+    *
+    * @brief A non-owning view of a single, trimmed CSV field
+    *
+    * The field points straight into the buffer scanned by the CsvReader (the mapped
+    * file or the current line), thus it's only valid until the next call to "next".
+    */
+   class CsvField
+   {
+   public:
+      const char * data;
+      size_t size;
+
+      CsvField()
+         : data(nullptr), size(0)
+      {}
+
+      CsvField(const char * d, size_t s)
+         : data(d), size(s)
+      {}
+
+      const char * begin() const { return data; }
+      const char * end() const { return data + size; }
+      bool empty() const { return size == 0; }
+
+      std::string str() const { return std::string(data, size); }
+   };
+
+   typedef std::vector<CsvField> CsvFieldVector;
+
+   /**
+    * @class CsvReader
+    *
+    * @brief Splits CSV lines into fields
+    *
+    * Three modes are supported:
+    *
+    *    - stream: lines are read from an std::istream, owned by the caller
+    *    - mapped: the file is memory mapped and scanned in place, without any copying
+    *    - compressed: a ".gz" file is decompressed in blocks of BLOCK_SIZE bytes, which are
+    *      scanned in place like a mapped file
+    *
+    * In all modes "next(CsvFieldVector &)" returns views into the reader's buffers. The
+    * "next(std::vector<std::string> &)" overload copies the fields out.
+    */
    class CsvReader
    {
    public:
       CsvReader(std::istream * stream)
-         : stream_(stream), numColumns_(-1), separators_(","), numLines_(0)
+         : stream_(stream), cursor_(nullptr), end_(nullptr), numColumns_(-1), separators_(","), numLines_(0)
       {}
 
       CsvReader(std::istream * stream, std::string separators)
-         : stream_(stream), numColumns_(-1), separators_(separators), numLines_(0)
+         : stream_(stream), cursor_(nullptr), end_(nullptr), numColumns_(-1), separators_(separators), numLines_(0)
       {}
 
+      // Memory maps the file, or decompresses it if the name ends in ".gz". A missing or
+      // an empty file reads as an empty CSV. Throws Poco::NotImplementedException for ".zst".
+      explicit CsvReader(const std::string & path, const std::string & separators = ",");
+
       CsvReader()
-         : stream_(nullptr)
+         : stream_(nullptr), cursor_(nullptr), end_(nullptr), numColumns_(-1), numLines_(0)
       {}
 
-      bool eof() const { return stream_->eof(); }
+      bool eof() const
+      {
+         if (stream_ != nullptr) return stream_->eof();
+         return cursor_ == end_ && (!inflater_ || !inflater_->good());
+      }
+
+      // Mapped mode only: the byte offset of the next line, and moving to a line at a given
+      // offset (as returned by "offset")
+      size_t offset() const { return cursor_ != nullptr ? cursor_ - mapping_.begin() : 0; }
+      void seek(size_t offset);
+
+      // "true" if the name ends in a suffix the reader decompresses
+      static bool isCompressed(const std::string & path);
 
       bool next(std::vector<std::string> & columns);
+      bool next(CsvFieldVector & fields);
 
    private:
+      static const size_t BLOCK_SIZE = 1 << 20;
+
+      bool nextLine(const char * & begin, const char * & end);
+      // Compressed mode: appends a block to the unscanned data, "false" at the end of the input
+      bool fill();
+      void split(const char * begin, const char * end, CsvFieldVector & fields) const;
+
+      bool isSeparator(char c) const { return std::memchr(separators_.data(), c, separators_.size()) != nullptr; }
+
+      static bool isSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
       std::istream * stream_;
+
+      // Mapped mode: the mapping keeps the file alive, [cursor_, end_) is what's left to scan
+      Poco::SharedMemory mapping_;
+      const char * cursor_;
+      const char * end_;
+
+      // Stream mode: the current line, reused across calls
+      std::string line_;
+
+      // Compressed mode: [cursor_, end_) points into buffer_. The inflater reads from file_.
+      std::unique_ptr<Poco::FileInputStream> file_;
+      std::unique_ptr<Poco::InflatingInputStream> inflater_;
+      std::vector<char> buffer_;
+
       sint numColumns_;
       sint numLines_;
       std::string separators_;
@@ -45,4 +138,4 @@ namespace tradelib
    POCO_DECLARE_EXCEPTION(, CsvException, Poco::Exception)
 }
 
-#endif // CSV_READER_H
\ No newline at end of file
+#endif // CSV_READER_H
@@ -8,11 +8,11 @@
 #include <unordered_map>
 
 // libraries headers
-#include "Poco/BasicEvent.h"
 #include "Poco/JSON/Object.h"
 
 // tradelib headers
 #include "tradelib/BarFileReader.h"
+#include "tradelib/Event.h"
 #include "tradelib/Instrument.h"
 #include "tradelib/Types.h"
 
@@ -36,7 +36,7 @@ namespace tradelib
    class DataFeed
    {
    public:
-      Poco::BasicEvent<const Bar> barEvent;
+      Event<const Bar> barEvent;
 
       virtual void configure(const std::string & config) {}
       virtual void reset() {}
@@ -63,6 +63,12 @@ namespace tradelib
          return &it->second;
       }
 
+      typedef std::map<std::string, InstrumentVariation> InstrumentVariationMap;
+      typedef std::map<std::string, InstrumentVariationMap> InstrumentVariationProviders;
+
+      // All the variations, by provider (see below)
+      const InstrumentVariationProviders & instrumentVariations() const { return instrumentVariationProviders_; }
+
    protected:
       typedef std::unordered_map<std::string, Instrument> InstrumentMap;
       InstrumentMap instruments_;
@@ -80,8 +86,6 @@ namespace tradelib
       //    symbol = "EUR", factor = 100, tick = 0.0001
       //
       // This varition will be stored in the map for "ib". 
-      typedef std::map<std::string, InstrumentVariation> InstrumentVariationMap;
-      typedef std::map<std::string, InstrumentVariationMap> InstrumentVariationProviders;
       InstrumentVariationProviders instrumentVariationProviders_;
    };
 }
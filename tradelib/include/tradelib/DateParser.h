@@ -0,0 +1,61 @@
+#ifndef DATE_PARSER_H
+#define DATE_PARSER_H
+
+// std headers
+#include <string>
+
+// tradelib headers
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class DateParser
+    *
+    * @brief Parses the date column of bar files
+    *
+    * The common fixed numeric layouts (see Layout) are parsed directly from the characters,
+    * everything else goes through Poco::DateTimeParser. An empty format means Poco's format
+    * auto-detection. Strings which don't fit the fixed layout exactly (wrong length, non-digits,
+    * invalid dates) are also handed over to Poco, so the results (and the exceptions) are the
+    * same as with Poco alone.
+    *
+    * The conversion of the year and month into days since the epoch is cached - consecutive
+    * bars almost always fall in the same month.
+    */
+   class DateParser
+   {
+   public:
+      DateParser()
+         : DateParser(std::string())
+      {}
+
+      explicit DateParser(const std::string & format);
+
+      Timestamp parse(const char * begin, const char * end);
+      Timestamp parse(const std::string & s) { return parse(s.data(), s.data() + s.size()); }
+
+      const std::string & format() const { return format_; }
+
+   protected:
+      enum class Layout
+      {
+         GENERIC,             // anything, parsed by Poco
+         YYYYMMDD,            // %Y%m%d
+         YYYY_MM_DD,          // %Y-%m-%d
+         YYYY_MM_DD_HH_MM_SS  // %Y-%m-%d %H:%M:%S
+      };
+
+      bool tryParseFixed(const char * begin, const char * end, Timestamp & timestamp);
+      sint64 monthToDays(sint year, sint month);
+
+      std::string format_;
+      Layout layout_;
+
+      // The last (year, month) converted to days since the epoch
+      sint cachedMonth_;
+      sint64 cachedDays_;
+   };
+}
+
+#endif // DATE_PARSER_H
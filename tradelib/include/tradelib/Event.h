@@ -0,0 +1,165 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+// std headers
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// libraries headers
+#include "Poco/BasicEvent.h"
+
+namespace tradelib
+{
+   /**
+    * @class Event
+    *
+    * @brief A single threaded event with pre-bound handlers
+    *
+    * A handler is a plain function pointer and a context pointer. Member functions are bound
+    * at compile time, via "connect", so firing the event is a loop of direct calls: no lock,
+    * no copies of the handler list, no virtual calls. The first INLINE_SIZE handlers are
+    * stored within the event itself.
+    *
+    *    barEvent.connect<HistoricalReplay, &HistoricalReplay::barEventHandler>(this);
+    *
+    * Both the Poco handler signatures are supported: (const void * sender, TArgs & args)
+    * and (TArgs & args).
+    *
+    * Poco delegates can still be attached via "+=" and "-=". They go through a Poco::BasicEvent
+    * owned by the event, which is only created when first needed, and are notified in the
+    * position of the first Poco delegate attached.
+    *
+    * Handlers must not connect to or disconnect from an event while it's being fired.
+    */
+   template<class TArgs>
+   class Event
+   {
+   public:
+      typedef void (*Function)(void * context, const void * sender, TArgs & args);
+
+      Event()
+         : size_(0)
+      {}
+
+      Event(const Event &) = delete;
+      Event & operator=(const Event &) = delete;
+
+      template<class C, void (C::*M)(const void *, TArgs &)>
+      void connect(C * object)
+      {
+         add(&invoke<C, M>, object);
+      }
+
+      template<class C, void (C::*M)(TArgs &)>
+      void connect(C * object)
+      {
+         add(&invokeWithoutSender<C, M>, object);
+      }
+
+      void connect(Function function, void * context)
+      {
+         add(function, context);
+      }
+
+      // Removes all the handlers bound to "context"
+      void disconnect(const void * context)
+      {
+         size_t kept = 0;
+         for (size_t ii = 0; ii < size_; ++ii)
+         {
+            if (at(ii).context != context) at(kept++) = at(ii);
+         }
+         resize(kept);
+      }
+
+      void notify(const void * sender, TArgs & args)
+      {
+         size_t inlineSize = size_ < INLINE_SIZE ? size_ : INLINE_SIZE;
+         for (size_t ii = 0; ii < inlineSize; ++ii) inline_[ii].function(inline_[ii].context, sender, args);
+         for (auto & hh : overflow_) hh.function(hh.context, sender, args);
+      }
+
+      void operator()(const void * sender, TArgs & args) { notify(sender, args); }
+      void operator()(TArgs & args) { notify(nullptr, args); }
+
+      // The Poco adapter
+      template<class TDelegate>
+      Event & operator+=(const TDelegate & delegate)
+      {
+         if (!pocoEvent_)
+         {
+            pocoEvent_.reset(new Poco::BasicEvent<TArgs>());
+            add(&forward, pocoEvent_.get());
+         }
+         *pocoEvent_ += delegate;
+         return *this;
+      }
+
+      template<class TDelegate>
+      Event & operator-=(const TDelegate & delegate)
+      {
+         if (pocoEvent_) *pocoEvent_ -= delegate;
+         return *this;
+      }
+
+      void clear()
+      {
+         resize(0);
+         pocoEvent_.reset();
+      }
+
+      bool empty() const { return size_ == 0; }
+
+   protected:
+      static const size_t INLINE_SIZE = 4;
+
+      class Handler
+      {
+      public:
+         Function function;
+         void * context;
+      };
+
+      template<class C, void (C::*M)(const void *, TArgs &)>
+      static void invoke(void * context, const void * sender, TArgs & args)
+      {
+         (static_cast<C *>(context)->*M)(sender, args);
+      }
+
+      template<class C, void (C::*M)(TArgs &)>
+      static void invokeWithoutSender(void * context, const void * sender, TArgs & args)
+      {
+         (static_cast<C *>(context)->*M)(args);
+      }
+
+      static void forward(void * context, const void * sender, TArgs & args)
+      {
+         static_cast<Poco::BasicEvent<TArgs> *>(context)->notify(sender, args);
+      }
+
+      Handler & at(size_t ii) { return ii < INLINE_SIZE ? inline_[ii] : overflow_[ii - INLINE_SIZE]; }
+
+      void add(Function function, void * context)
+      {
+         Handler handler = { function, context };
+         if (size_ < INLINE_SIZE) inline_[size_] = handler;
+         else overflow_.push_back(handler);
+         ++size_;
+      }
+
+      void resize(size_t size)
+      {
+         size_ = size;
+         overflow_.resize(size_ > INLINE_SIZE ? size_ - INLINE_SIZE : 0);
+      }
+
+      Handler inline_[INLINE_SIZE];
+      std::vector<Handler> overflow_;
+      size_t size_;
+
+      std::unique_ptr<Poco::BasicEvent<TArgs>> pocoEvent_;
+   };
+}
+
+#endif // EVENT_H
@@ -0,0 +1,128 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+// std headers
+#include <string>
+#include <vector>
+
+// libraries headers
+#include "Poco/Exception.h"
+
+// tradelib headers
+#include "tradelib/Bar.h"
+#include "tradelib/DataFeed.h"
+#include "tradelib/InstrumentRecord.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class EventLogHeader
+    *
+    * @brief The header of an event log file
+    *
+    * An event log is the bar stream of a data feed for a whole universe, already merged in
+    * timestamp order: the header, "symbols" symbol records (EventLogSymbol), "variations"
+    * instrument variation records (InstrumentVariationRecord) and "records" bar records
+    * (EventLogRecord), in the order the feed delivered the bars. See BinaryFile for the byte
+    * order.
+    */
+   class EventLogHeader
+   {
+   public:
+      static const uint32 MAGIC = 0x4c454c54; // "TLEL" in little endian
+      static const uint32 VERSION = 2;
+
+      uint32 magic;
+      uint32 version;
+      uint32 symbols;
+      uint32 variations;
+      uint64 records;
+   };
+
+   // The instrument of a symbol and where its bars are in the log
+   class EventLogSymbol
+   {
+   public:
+      InstrumentRecord instrument;
+      // The records of the first and past the last bar of the symbol, and the bar count
+      uint64 first;
+      uint64 end;
+      uint64 bars;
+   };
+
+   // 64 bytes, so a record never straddles a cache line
+   class EventLogRecord
+   {
+   public:
+      sint64 timestamp;
+      numeric open;
+      numeric high;
+      numeric low;
+      numeric close;
+      uint64 volume;
+      uint64 interest;
+      // The index of the symbol record
+      uint32 symbol;
+      uint32 reserved;
+   };
+
+   /**
+    * @class EventLog
+    *
+    * @brief Writes event logs
+    *
+    * Runs a source feed over a universe once and records the merged stream, so replays of
+    * any part of the universe become a single sequential read (see EventLogFeed) instead of
+    * one reader per symbol and a merge.
+    */
+   class EventLog
+   {
+   public:
+      // The bars are written as the source delivers them, they are not held in memory. An
+      // existing log is replaced only once the new one is complete (see BinaryFile).
+      static void write(DataFeed & source, const std::vector<std::string> & symbols, const std::string & path);
+   };
+
+   /**
+    * @class EventLogFeed
+    *
+    * @brief Streams an event log
+    *
+    * The constructor reads the header, the symbol and the variation records, the instruments
+    * and the instrument variations come from the log. "start" reads the records from the first
+    * bar of the subscribed symbols to the last one, in large blocks, and passes on the bars of
+    * the subscribed symbols.
+    *
+    * The bars of a symbol are interleaved with the others', so the read is not proportional to
+    * the subset: replaying a few symbols of a large universe reads all the records in their
+    * range. Log the universes replayed together rather than one for everything.
+    */
+   class EventLogFeed : public InstrumentRecordFeed
+   {
+   public:
+      explicit EventLogFeed(const std::string & path);
+
+      virtual void start();
+
+      uint64 records() const { return records_; }
+
+   protected:
+      // Records read at a time, 256K
+      static const uint32 BLOCK_RECORDS = 4096;
+
+      std::string path_;
+      // The offset of the first record
+      uint64 offset_;
+      uint64 records_;
+
+      // Indexed by the symbol record
+      std::vector<EventLogSymbol> table_;
+
+      std::vector<EventLogRecord> block_;
+   };
+
+   POCO_DECLARE_EXCEPTION(, EventLogException, Poco::Exception)
+}
+
+#endif // EVENT_LOG_H
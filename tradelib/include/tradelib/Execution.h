@@ -5,6 +5,7 @@
 #include <string>
 
 // tradelib headers
+#include "tradelib/Symbol.h"
 #include "Types.h"
 
 namespace tradelib
@@ -12,12 +13,13 @@ namespace tradelib
    class Execution
    {
    public:
+      Symbol symbol;
       Timestamp timestamp;
       numeric price;
       long quantity;
 
-      Execution(Timestamp t, numeric p, long q)
-         : timestamp(t), price(p), quantity(q)
+      Execution(const Symbol & s, Timestamp t, numeric p, long q)
+         : symbol(s), timestamp(t), price(p), quantity(q)
       {}
    };
 }
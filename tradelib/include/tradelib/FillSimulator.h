@@ -0,0 +1,287 @@
+#ifndef FILL_SIMULATOR_H
+#define FILL_SIMULATOR_H
+
+// std headers
+#include <memory>
+#include <utility>
+#include <vector>
+
+// libraries headers
+#include "Poco/BinaryReader.h"
+#include "Poco/BinaryWriter.h"
+#include "Poco/DateTime.h"
+
+// tradelib headers
+#include "tradelib/Broker.h"
+#include "tradelib/DataFeed.h"
+#include "tradelib/Execution.h"
+#include "tradelib/Instrument.h"
+#include "tradelib/Order.h"
+#include "tradelib/OrderStore.h"
+#include "tradelib/Portfolio.h"
+#include "tradelib/Trace.h"
+
+namespace tradelib
+{
+   /**
+    * @class FillSimulator
+    *
+    * @brief Executes the submitted orders against the bars of a historical replay
+    *
+    * Keeps the orders, the positions and the portfolio. "processBar" walks a bar through the
+    * open, the high, the low and the close, filling the eligible orders at each point, and
+    * reports back to a handler, which is any class providing:
+    *
+    *    void onBarOpen(const Bar & bar);
+    *    void onBarClose(const Bar & bar);
+    *    void onBarClosed(const Bar & bar);
+    *    void onOrderNotification(const OrderNotification & on);
+    *
+    * The handler is a template parameter, so the calls are direct (and may be inlined).
+    *
+    * The state (positions, active orders and the portfolio) can be saved and loaded back,
+    * see Checkpoint. After a load, the bars up to the last one processed before the save
+    * are skipped, symbol by symbol - a replay over the same data, extended, resumes where
+    * the saved one stopped.
+    */
+   class FillSimulator
+   {
+   public:
+      FillSimulator(DataFeed * dataFeed = nullptr)
+         : dataFeed_(dataFeed), trace_(nullptr)
+      {}
+
+      // The orders are addressed by their handles until filled, cancelled or expired. A
+      // cancelled or amended order takes effect from the next tick on.
+      OrderHandle submitOrder(const Order & order);
+
+      // Order groups. When an order of a one-cancels-other group fills, the others are
+      // cancelled. The target and the stop of a bracket wait for the entry to fill, then
+      // form a one-cancels-other group, eligible from the next tick (of the same bar). They
+      // are cancelled with the entry if it expires or is cancelled. Groups are resolved as
+      // the orders fill, without the strategy or a scan of the exit orders.
+      void submitOco(const Order & first, const Order & second, OrderHandle & firstHandle, OrderHandle & secondHandle);
+      void submitBracket(
+               const Order & entry,
+               const Order & target,
+               const Order & stop,
+               OrderHandle & entryHandle,
+               OrderHandle & targetHandle,
+               OrderHandle & stopHandle);
+
+      bool cancelOrder(OrderHandle handle);
+      bool modifyOrder(OrderHandle handle, numeric price);
+      const Broker::InstrumentPosition * getInstrumentPosition(const Symbol & symbol) const;
+
+      const Portfolio & portfolio() const { return portfolio_; }
+
+      // Records the order lifecycle into "trace" (not owned), nullptr to stop
+      void setTrace(Trace * trace) { trace_ = trace; }
+      Trace * trace() const { return trace_; }
+
+      template<class Handler>
+      void processBar(const Bar & bar, Handler & handler);
+
+      // Removes all per instrument runtime data
+      void reset()
+      {
+         instrumentCBs_.clear();
+         orders_.clear();
+      }
+
+      // The instruments must be available from the data feed (subscribed) before a load
+      void save(Poco::BinaryWriter & writer) const;
+      void load(Poco::BinaryReader & reader);
+
+   protected:
+      typedef std::vector<OrderNotification> OrderNotificationVector;
+      typedef std::vector<Execution> ExecutionVector;
+      // Slots in the order store
+      typedef std::vector<uint32> OrderSlotVector;
+      // Positions in an OrderSlotVector
+      typedef std::vector<uint32> OrderPositionVector;
+
+      /**
+       * @class TriggerIndex
+       *
+       * @brief The active orders of an instrument, sorted by trigger price (see Order::trigger)
+       *
+       * One sorted vector per direction, so the orders a tick may trigger are a prefix of the
+       * rising ones and a suffix of the falling ones - found with a binary search each. The
+       * market orders are always candidates. The index is rebuilt when the order list changes
+       * or a stop limit is stopped (its trigger moves to the limit price), not per tick.
+       */
+      class TriggerIndex
+      {
+      public:
+         void build(const OrderSlotVector & orders, const OrderStore & store);
+
+         // Appends the positions of the orders a tick at "price" may trigger, unsorted
+         void collect(numeric price, OrderPositionVector & positions) const;
+
+      protected:
+         // (trigger price, position)
+         typedef std::pair<numeric, uint32> Entry;
+         typedef std::vector<Entry> EntryVector;
+
+         EntryVector rising_;
+         EntryVector falling_;
+         OrderPositionVector unconditional_;
+      };
+
+      class InstrumentCB
+      {
+      public:
+         // Pointer to the instrument
+         const Instrument * instrument;
+         // Position information
+         Broker::InstrumentPosition instrumentPosition;
+         // The orders, in the order of submission
+         OrderSlotVector orders;
+         // The new orders merged at specific points into the orders list
+         OrderSlotVector newOrders;
+         // The executions of the current bar
+         ExecutionVector executions;
+         // The order notifications for this instrument
+         OrderNotificationVector orderNotifications;
+         // The active orders by trigger price, rebuilt before use when stale
+         TriggerIndex triggers;
+         bool triggersStale;
+         // The timestamp of the last bar processed
+         Timestamp lastBar;
+         // The bars up to this one were processed before the state was loaded
+         Timestamp resumeAfter;
+
+         InstrumentCB()
+            : instrument(nullptr), instrumentPosition(0, TIMESTAMP_MIN), triggersStale(false), lastBar(TIMESTAMP_MIN), resumeAfter(TIMESTAMP_MIN)
+         {}
+
+         InstrumentCB(const Instrument * i)
+            : instrument(i), instrumentPosition(0, TIMESTAMP_MIN), triggersStale(false), lastBar(TIMESTAMP_MIN), resumeAfter(TIMESTAMP_MIN)
+         {}
+      };
+
+      // Indexed by the symbol id, null for symbols without a control block. The control blocks
+      // are allocated individually, they must not move while orders are processed.
+      typedef std::vector<std::unique_ptr<InstrumentCB>> InstrumentCBVector;
+      InstrumentCBVector instrumentCBs_;
+
+      // The instruments are looked up in the data feed
+      DataFeed * dataFeed_;
+
+      // The portfolio
+      Portfolio portfolio_;
+
+      // The orders of all instruments
+      OrderStore orders_;
+
+      // The orders triggered at the current tick, reused across ticks
+      OrderPositionVector triggered_;
+
+      // The order lifecycle records, nullptr if not traced
+      Trace * trace_;
+
+      InstrumentCB & lookupInstrumentCB(const Symbol & symbol);
+
+      void addNewOrders(InstrumentCB & icb);
+      void processOrders(InstrumentCB & icb, const Tick & tick, bool executeOnLimitOrStop);
+      void cleanupOrders(InstrumentCB & icb, const Bar & bar);
+      void resolveGroups(InstrumentCB & icb, const Order & order, Timestamp timestamp);
+      void cancelChildren(const Order & order, Timestamp timestamp);
+
+      template<class Handler>
+      void postOrderNotifications(InstrumentCB & icb, Handler & handler)
+      {
+         for (auto & on : icb.orderNotifications)
+         {
+            handler.onOrderNotification(on);
+         }
+         icb.orderNotifications.resize(0);
+      }
+   };
+
+   template<class Handler>
+   void FillSimulator::processBar(const Bar & bar, Handler & handler)
+   {
+      InstrumentCB & icb = lookupInstrumentCB(bar.symbol);
+
+      // 0. Skip the bars processed before the state was loaded
+      if (bar.timestamp <= icb.resumeAfter) return;
+      icb.lastBar = bar.timestamp;
+
+      // 1. All orders are eligible for execution at this point.
+      addNewOrders(icb);
+
+      // 2. Process orders at open. At the open the limit and stop orders
+      // are executed on the tick (using false for executeOnLimitOrStop).
+      Poco::DateTime dt(bar.timestamp);
+      dt.assign(dt.year(), dt.month(), dt.day(), 9, 0, 1);
+      Poco::Timestamp ts = dt.timestamp();
+      processOrders(icb, Tick(bar.symbol, ts, bar.open), false);
+
+      // 3. Send notifications for the executed trades
+      postOrderNotifications(icb, handler);
+
+      // 4. Notify for the opening of the bar. We use a bar, not a Tick object,
+      // so that the callee can use (symbol, timespan) to identify the bar set
+      // this bar belongs to. The callee may use only the open price from the bar.
+      Bar openBar = bar;
+      openBar.high = openBar.low = openBar.close = NAN;
+      openBar.volume = openBar.interest = LONG_MIN;
+      handler.onBarOpen(openBar);
+
+      // 5. Pick up any new orders submitted during steps 2. and 4.
+      addNewOrders(icb);
+
+      // 6. Process orders at high (assume at 11:00:01)
+      dt.assign(dt.year(), dt.month(), dt.day(), 11, 0, 1);
+      ts = dt.timestamp();
+      processOrders(icb, Tick(bar.symbol, ts, bar.high), true);
+
+      // No new orders are added here. Orders submitted during the *high*
+      // processing are not eligible for execution during the *low* processing.
+
+      // 7. Send notifications for the executed trades
+      postOrderNotifications(icb, handler);
+
+      // 8. Process orders at low (assume at 13:00:01)
+      dt.assign(dt.year(), dt.month(), dt.day(), 13, 0, 1);
+      ts = dt.timestamp();
+      processOrders(icb, Tick(bar.symbol, ts, bar.low), true);
+
+      // 9. Send notifications for the executed trades
+      postOrderNotifications(icb, handler);
+
+      // 10. Publish the bar, but it's not closed yet - this is to accomodate trading
+      // where the signal is computed at the close and the trading takes place at the close.
+      handler.onBarClose(bar);
+
+      // 11. Pick up any new orders submitted during the previous two steps. Everything
+      // is eligible to be processed at the close.
+      addNewOrders(icb);
+
+      // 12. Process orders at close
+      dt.assign(dt.year(), dt.month(), dt.day(), 16, 0, 1);
+      ts = dt.timestamp();
+      processOrders(icb, Tick(bar.symbol, ts, bar.close), false);
+
+      // 13. Send notifications for the executed trades
+      postOrderNotifications(icb, handler);
+
+      // 14. The bar is closed
+      handler.onBarClosed(bar);
+
+      // 15. Make all orders eligible
+      addNewOrders(icb);
+
+      // 16. The executions of the bar were all notified, keep the capacity for the next one
+      icb.executions.clear();
+
+      // 17. It's not safe to cleanup the order vectors earlier, since notifications
+      // point straight into the order vector. So all order updates (expiration and/or
+      // removal from the list) had to be postponed til now.
+      cleanupOrders(icb, bar);
+   }
+}
+
+#endif // FILL_SIMULATOR_H
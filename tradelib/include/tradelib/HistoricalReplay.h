@@ -2,13 +2,12 @@
 #define HISTORICAL_REPLAY_H
 
 // std headers
-#include <map>
-#include <unordered_map>
+#include <string>
 
 // tradelib headers
 #include "tradelib/Broker.h"
 #include "tradelib/DataFeed.h"
-#include "tradelib/Execution.h"
+#include "tradelib/FillSimulator.h"
 #include "tradelib/Instrument.h"
 #include "tradelib/Order.h"
 #include "tradelib/Portfolio.h"
@@ -27,8 +26,18 @@ namespace tradelib
       virtual void start();
       virtual void subscribe(const std::string & symbol);
       virtual void unsubscribe(const std::string & symbol);
-      virtual void submitOrder(const Order & order);
-      virtual const InstrumentPosition * getInstrumentPosition(const std::string & symbol);
+      virtual OrderHandle submitOrder(const Order & order);
+      virtual bool cancelOrder(OrderHandle handle);
+      virtual bool modifyOrder(OrderHandle handle, numeric price);
+      virtual void submitOco(const Order & first, const Order & second, OrderHandle & firstHandle, OrderHandle & secondHandle);
+      virtual void submitBracket(
+               const Order & entry,
+               const Order & target,
+               const Order & stop,
+               OrderHandle & entryHandle,
+               OrderHandle & targetHandle,
+               OrderHandle & stopHandle);
+      virtual const InstrumentPosition * getInstrumentPosition(const Symbol & symbol);
       virtual const InstrumentVariation * getInstrumentVariation(const std::string & provider, const std::string & symbol);
       virtual const Instrument * getInstrument(const std::string & symbol);
       virtual void reset();
@@ -37,53 +46,26 @@ namespace tradelib
       virtual const Portfolio * getPortfolio(const std::string & portfolio);
       virtual void getPositionPnl(const std::string & symbol, numeric price, numeric & realized, numeric & unrealized);
 
-   protected:
-      typedef std::vector<Order> OrderVector;
-      typedef std::vector<OrderNotification> OrderNotificationVector;
-      typedef std::vector<Execution> ExecutionVector;
-
-      class InstrumentCB
-      {
-      public:
-         // Pointer to the instrument
-         const Instrument * instrument;
-         // Position information
-         Broker::InstrumentPosition instrumentPosition;
-         // The orders
-         OrderVector orders;
-         // The new orders merged at specific points into the orders list
-         OrderVector newOrders;
-         // The executions
-         ExecutionVector executions;
-         // The order notifications for this instrument
-         OrderNotificationVector orderNotifications;
-
-         InstrumentCB()
-            : instrument(nullptr), instrumentPosition(0, TIMESTAMP_MIN)
-         {}
-
-         InstrumentCB(const Instrument * i)
-            : instrument(i), instrumentPosition(0, TIMESTAMP_MIN)
-         {}
-      };
-
-      typedef std::unordered_map<std::string, InstrumentCB> InstrumentCBMap;
-      InstrumentCBMap instrumentCBMap_;
+      // The orders, the positions and the portfolio, i.e. for Checkpoint
+      FillSimulator & simulator() { return simulator_; }
+      const FillSimulator & simulator() const { return simulator_; }
 
+   protected:
       // The data feed object
       DataFeed * dataFeed_;
 
-      // The portfolio
-      Portfolio portfolio_;
-
-      InstrumentCB & lookupInstrumentCB(const std::string & symbol);
+      // The orders, the positions and the portfolio
+      FillSimulator simulator_;
 
       void barEventHandler(const Bar & bar);
 
-      void addNewOrders(InstrumentCB & icb);
-      void processOrders(InstrumentCB & icb, const Tick & tick, bool executeOnLimitOrStop);
-      void postOrderNotifications(InstrumentCB & icb);
-      void cleanupOrders(InstrumentCB & icb, const Bar & bar);
+      // The fill simulator handler - forwards to the Broker events
+      void onBarOpen(const Bar & bar) { barOpenEvent(this, bar); }
+      void onBarClose(const Bar & bar) { barCloseEvent(this, bar); }
+      void onBarClosed(const Bar & bar) { barClosedEvent(this, bar); }
+      void onOrderNotification(const OrderNotification & on) { orderNotificationEvent(this, on); }
+
+      friend class FillSimulator;
    };
 }
 
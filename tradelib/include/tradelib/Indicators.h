@@ -5,6 +5,7 @@
 #include <math.h>
 
 // tradelib headers
+#include "tradelib/Serialization.h"
 #include "tradelib/Types.h"
 
 namespace tradelib
@@ -25,7 +26,7 @@ namespace tradelib
             sum_ += value;
 
             // The size of the vector after a push_back
-            uint newSize = static_cast<uint>(values.size()) + 1;
+            uint newSize = static_cast<uint>(values.size() + values.dropped()) + 1;
             if (newSize > U)
             {
                // Convert to the real sender type
@@ -48,7 +49,7 @@ namespace tradelib
          else
          {
             // The size of the vector after a push_back
-            uint newSize = static_cast<uint>(values.size()) + 1;
+            uint newSize = static_cast<uint>(values.size() + values.dropped()) + 1;
             if (newSize >= U)
             {
                // Convert to the real sender type
@@ -74,6 +75,9 @@ namespace tradelib
 
       numeric operator[](sint ii) { return values[ii]; }
 
+      // Keeps the last "window" values at least, see RVector
+      void setWindow(sint window) { values.setWindow(window); }
+
       static numeric value(const NumericRVector & data, sint ii = 0)
       {
          poco_assert(ii >= 0);
@@ -91,6 +95,19 @@ namespace tradelib
          return sum/U;
       }
 
+      // See Strategy::saveState
+      void save(Poco::BinaryWriter & writer) const
+      {
+         serialize(writer, values);
+         writer << sum_;
+      }
+
+      void load(Poco::BinaryReader & reader)
+      {
+         deserialize(reader, values);
+         reader >> sum_;
+      }
+
    protected:
       numeric sum_ = 0.0;
    };
@@ -104,12 +121,19 @@ namespace tradelib
       NumericRVector sma;
       NumericRVector stdDev;
 
+      // Keeps the last "window" values at least, see RVector
+      void setWindow(sint window)
+      {
+         sma.setWindow(window);
+         stdDev.setWindow(window);
+      }
+
       void onValue(const void * sender, const numeric & value)
       {
          if (Accumulative)
          {
             // The size of the vector after a push_back
-            uint newSize = static_cast<uint>(sma.size()) + 1;
+            uint newSize = static_cast<uint>(sma.size() + sma.dropped()) + 1;
             if (newSize > U)
             {
                numeric oldMean = mean_;
@@ -185,7 +209,7 @@ namespace tradelib
          else
          {
             // The size of the vector after a push_back
-            uint newSize = static_cast<uint>(sma.size()) + 1;
+            uint newSize = static_cast<uint>(sma.size() + sma.dropped()) + 1;
             if (newSize >= U)
             {
                // Convert to the real sender type
@@ -220,6 +244,21 @@ namespace tradelib
          }
       }
 
+      // See Strategy::saveState
+      void save(Poco::BinaryWriter & writer) const
+      {
+         serialize(writer, sma);
+         serialize(writer, stdDev);
+         writer << sum_ << sumSquares_ << mean_ << var_;
+      }
+
+      void load(Poco::BinaryReader & reader)
+      {
+         deserialize(reader, sma);
+         deserialize(reader, stdDev);
+         reader >> sum_ >> sumSquares_ >> mean_ >> var_;
+      }
+
    protected:
       numeric sum_ = 0.0;
       numeric sumSquares_ = 0.0;
@@ -244,6 +283,14 @@ namespace tradelib
       numeric get() const { return mean_; }
       ulong size() const { return size_; }
 
+      void save(Poco::BinaryWriter & writer) const { writer << mean_ << static_cast<Poco::UInt64>(size_); }
+      void load(Poco::BinaryReader & reader)
+      {
+         Poco::UInt64 size = 0;
+         reader >> mean_ >> size;
+         size_ = static_cast<ulong>(size);
+      }
+
    protected:
       numeric mean_;
       ulong size_;
@@ -287,6 +334,14 @@ namespace tradelib
       numeric getStdDev() const { return std::sqrt(getVariance()); }
       ulong size() const { return size_; }
 
+      void save(Poco::BinaryWriter & writer) const { writer << mean_ << variance_ << static_cast<Poco::UInt64>(size_); }
+      void load(Poco::BinaryReader & reader)
+      {
+         Poco::UInt64 size = 0;
+         reader >> mean_ >> variance_ >> size;
+         size_ = static_cast<ulong>(size);
+      }
+
    protected:
       numeric mean_;
       numeric variance_;
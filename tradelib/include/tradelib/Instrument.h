@@ -6,6 +6,7 @@
 
 // tradelib headers
 #include "tradelib/Math.h"
+#include "tradelib/Symbol.h"
 #include "tradelib/Types.h"
 
 namespace tradelib
@@ -50,7 +51,7 @@ namespace tradelib
 
       numeric tick() const { return tick_; }
       numeric bpv() const { return bpv_; }
-      const std::string & symbol() const { return symbol_; }
+      const Symbol & symbol() const { return symbol_; }
       const std::string & name() const { return name_; }
 
       bool isFuture() const { return type_ == Type::FUTURE; }
@@ -70,7 +71,7 @@ namespace tradelib
       }
 
       Type type_;
-      std::string symbol_;
+      Symbol symbol_;
       numeric tick_;
       numeric bpv_;
       std::string name_;
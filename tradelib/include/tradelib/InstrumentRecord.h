@@ -0,0 +1,124 @@
+#ifndef INSTRUMENT_RECORD_H
+#define INSTRUMENT_RECORD_H
+
+// std headers
+#include <string>
+#include <vector>
+
+// tradelib headers
+#include "tradelib/DataFeed.h"
+#include "tradelib/Instrument.h"
+#include "tradelib/Symbol.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class InstrumentRecord
+    *
+    * @brief An instrument, as stored in the binary bar files (see BarStore and EventLog)
+    *
+    * Fixed size, the strings are zero padded. The symbol must fit (see "fits"), the name
+    * is truncated.
+    */
+   class InstrumentRecord
+   {
+   public:
+      static const uint32 MAX_SYMBOL_LENGTH = 31;
+      static const uint32 MAX_NAME_LENGTH = 63;
+
+      char symbol[MAX_SYMBOL_LENGTH + 1];
+      char name[MAX_NAME_LENGTH + 1];
+      numeric tick;
+      numeric bpv;
+      uint32 future;
+      uint32 reserved;
+
+      static bool fits(const std::string & symbol) { return symbol.size() <= MAX_SYMBOL_LENGTH; }
+
+      void set(const Instrument & instrument);
+      Instrument instrument() const;
+      std::string symbolName() const;
+   };
+
+   /**
+    * @class InstrumentVariationRecord
+    *
+    * @brief An instrument variation (see DataFeed), as stored in the binary bar files
+    *
+    * Fixed size and zero padded like InstrumentRecord, the strings must fit (see "fits").
+    */
+   class InstrumentVariationRecord
+   {
+   public:
+      static const uint32 MAX_LENGTH = 31;
+
+      char provider[MAX_LENGTH + 1];
+      // The symbol of the feed
+      char symbol[MAX_LENGTH + 1];
+      // The symbol at the provider
+      char variationSymbol[MAX_LENGTH + 1];
+      numeric factor;
+      numeric tick;
+
+      static bool fits(const std::string & provider, const std::string & symbol, const InstrumentVariation & variation)
+      {
+         return provider.size() <= MAX_LENGTH && symbol.size() <= MAX_LENGTH && variation.symbol.size() <= MAX_LENGTH;
+      }
+
+      void set(const std::string & provider, const std::string & symbol, const InstrumentVariation & variation);
+      std::string providerName() const;
+      std::string symbolName() const;
+      InstrumentVariation variation() const;
+   };
+
+   // The record of each symbol id, for the writers
+   class InstrumentRecordIndex
+   {
+   public:
+      static const uint32 NO_RECORD = 0xffffffff;
+
+      void add(const Symbol & symbol, uint32 record)
+      {
+         if (symbol.id() >= records_.size()) records_.resize(symbol.id() + 1, NO_RECORD);
+         records_[symbol.id()] = record;
+      }
+
+      // NO_RECORD for the symbols not added
+      uint32 find(const Symbol & symbol) const
+      {
+         return symbol.id() < records_.size() ? records_[symbol.id()] : NO_RECORD;
+      }
+
+   protected:
+      std::vector<uint32> records_;
+   };
+
+   /**
+    * @class InstrumentRecordFeed
+    *
+    * @brief The instruments and the subscriptions of a feed reading a bar file
+    *
+    * The subclasses add the instrument records of the file in order and replay the bars of
+    * the subscribed ones, by record. They add the variation records too.
+    */
+   class InstrumentRecordFeed : public DataFeed
+   {
+   public:
+      virtual void reset() { subscribed_.assign(subscribed_.size(), false); }
+
+      virtual void subscribe(const std::string & symbol);
+      virtual void unsubscribe(const std::string & symbol);
+
+   protected:
+      void addInstrument(const InstrumentRecord & record);
+      void addVariation(const InstrumentVariationRecord & record);
+      sint find(const std::string & symbol) const;
+
+      // Indexed by the instrument record
+      std::vector<Symbol> symbols_;
+      std::vector<bool> subscribed_;
+   };
+}
+
+#endif // INSTRUMENT_RECORD_H
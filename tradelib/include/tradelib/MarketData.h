@@ -0,0 +1,129 @@
+#ifndef MARKET_DATA_H
+#define MARKET_DATA_H
+
+// std headers
+#include <memory>
+#include <string>
+#include <vector>
+
+// tradelib headers
+#include "tradelib/Bar.h"
+#include "tradelib/DataFeed.h"
+#include "tradelib/Instrument.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class MarketData
+    *
+    * @brief The bars of a set of symbols, loaded once and shared by many replays
+    *
+    * The constructor subscribes the symbols to a source feed, runs it and keeps the bars in
+    * the order the feed delivered them (timestamp order), along with the instruments and the
+    * instrument variations of the feed. Afterwards the object is immutable,
+    * so a single instance can back any number of concurrent replays (see MarketDataFeed).
+    */
+   class MarketData
+   {
+   public:
+      MarketData(DataFeed & source, const std::vector<std::string> & symbols);
+
+      MarketData(const MarketData &) = delete;
+      MarketData & operator=(const MarketData &) = delete;
+
+      const std::vector<Bar> & bars() const { return bars_; }
+      const std::vector<std::string> & symbols() const { return symbols_; }
+
+      // The instruments of the symbols, in the order of "symbols"
+      const std::vector<Instrument> & instruments() const { return instruments_; }
+
+      // The instrument variations of the source feed, all of them
+      const DataFeed::InstrumentVariationProviders & variations() const { return variations_; }
+
+      // The closing prices of a symbol, for the PnL computations. Empty if there are no bars.
+      const NumericIndexer & closes(const Symbol & symbol) const
+      {
+         return symbol.id() < closes_.size() ? closes_[symbol.id()] : empty_;
+      }
+
+   protected:
+      void barEventHandler(const Bar & bar);
+
+      std::vector<Bar> bars_;
+      std::vector<std::string> symbols_;
+      std::vector<Instrument> instruments_;
+      DataFeed::InstrumentVariationProviders variations_;
+      // Indexed by the symbol id
+      std::vector<NumericIndexer> closes_;
+      NumericIndexer empty_;
+   };
+
+   /**
+    * @class MarketDataFeed
+    *
+    * @brief Replays shared MarketData
+    *
+    * Cheap to create, one per replay. Replays the bars of the subscribed symbols, which must be
+    * part of the MarketData.
+    */
+   class MarketDataFeed : public DataFeed
+   {
+   public:
+      explicit MarketDataFeed(std::shared_ptr<const MarketData> data);
+
+      virtual void reset() { subscribed_.clear(); }
+
+      virtual void subscribe(const std::string & symbol);
+      virtual void unsubscribe(const std::string & symbol);
+      virtual void start();
+
+      // Same as "start", but the bars go straight to "handler.onBar(const Bar & bar)"
+      template<class Handler>
+      void run(Handler & handler)
+      {
+         for (const Bar & bar : data_->bars())
+         {
+            if (isSubscribed(bar.symbol)) handler.onBar(bar);
+         }
+      }
+
+      const MarketData & data() const { return *data_; }
+
+   protected:
+      bool isSubscribed(const Symbol & symbol) const { return symbol.id() < subscribed_.size() && subscribed_[symbol.id()]; }
+
+      std::shared_ptr<const MarketData> data_;
+      // Indexed by the symbol id
+      std::vector<bool> subscribed_;
+   };
+
+   /**
+    * @class InMemoryDataFeed
+    *
+    * @brief A feed holding its own copy of the bars of another one
+    *
+    * Reads the source once, at construction, and then replays any subset of the symbols any
+    * number of times. "reset" only drops the subscriptions, nothing is read again, so a
+    * HistoricalReplay can be reset and rerun in a loop at the cost of the replay alone:
+    *
+    *    InMemoryDataFeed feed(pinnacleFeed, { "ES", "YM" });
+    *    HistoricalReplay replay(feed);
+    *    for (...)
+    *    {
+    *       MyStrategy strategy(&replay, ...);
+    *       replay.subscribe("ES");
+    *       replay.start();
+    *       replay.reset();
+    *    }
+    */
+   class InMemoryDataFeed : public MarketDataFeed
+   {
+   public:
+      InMemoryDataFeed(DataFeed & source, const std::vector<std::string> & symbols)
+         : MarketDataFeed(std::make_shared<const MarketData>(source, symbols))
+      {}
+   };
+}
+
+#endif // MARKET_DATA_H
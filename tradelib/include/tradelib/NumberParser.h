@@ -0,0 +1,92 @@
+#ifndef NUMBER_PARSER_H
+#define NUMBER_PARSER_H
+
+// tradelib headers
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class NumberParser
+    *
+    * @brief Parses the numeric columns of bar files in place
+    *
+    * The results (and the exceptions) are those of std::stod and std::stol on the same
+    * characters, in the "C" locale, without the std::string copies:
+    *
+    *    - plain decimals of up to 15 digits ("1162.20", "-3", "0.0001") are converted directly.
+    *      The digits form an integer which is exact as a double, and so is the power of ten
+    *      dividing it - a single division of exact values is correctly rounded, like strtod.
+    *    - integers of up to 9 digits are converted directly, they fit a 32 bit long.
+    *    - everything else (exponents, long mantissas, spaces, garbage) goes to std::stod/std::stol.
+    */
+   class NumberParser
+   {
+   public:
+      static numeric parseNumeric(const char * begin, const char * end)
+      {
+         numeric result;
+         if (tryParseDecimal(begin, end, result)) return result;
+         return parseNumericSlow(begin, end);
+      }
+
+      static long parseLong(const char * begin, const char * end)
+      {
+         long result;
+         if (tryParseInteger(begin, end, result)) return result;
+         return parseLongSlow(begin, end);
+      }
+
+   protected:
+      static const sint MAX_DECIMAL_DIGITS = 15;
+      static const sint MAX_INTEGER_DIGITS = 9;
+
+      static bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+      static bool tryParseDecimal(const char * begin, const char * end, numeric & result)
+      {
+         static const numeric POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+         const char * it = begin;
+         bool negative = false;
+         if (it != end && (*it == '-' || *it == '+')) negative = *it++ == '-';
+
+         uint64 mantissa = 0;
+         sint digits = 0;
+         sint fractionDigits = 0;
+         for (; it != end && isDigit(*it); ++it, ++digits) mantissa = mantissa*10 + (*it - '0');
+         if (it != end && *it == '.')
+         {
+            for (++it; it != end && isDigit(*it); ++it, ++digits, ++fractionDigits) mantissa = mantissa*10 + (*it - '0');
+         }
+
+         // Whatever is left is handled by std::stod
+         if (it != end || digits == 0 || digits > MAX_DECIMAL_DIGITS) return false;
+
+         result = static_cast<numeric>(mantissa) / POWERS_OF_TEN[fractionDigits];
+         if (negative) result = -result;
+         return true;
+      }
+
+      static bool tryParseInteger(const char * begin, const char * end, long & result)
+      {
+         const char * it = begin;
+         bool negative = false;
+         if (it != end && (*it == '-' || *it == '+')) negative = *it++ == '-';
+
+         long value = 0;
+         sint digits = 0;
+         for (; it != end && isDigit(*it); ++it, ++digits) value = value*10 + (*it - '0');
+
+         if (it != end || digits == 0 || digits > MAX_INTEGER_DIGITS) return false;
+
+         result = negative ? -value : value;
+         return true;
+      }
+
+      static numeric parseNumericSlow(const char * begin, const char * end);
+      static long parseLongSlow(const char * begin, const char * end);
+   };
+}
+
+#endif // NUMBER_PARSER_H
@@ -5,51 +5,69 @@
 #include <string>
 
 // libraries headers
+#include "Poco/BinaryReader.h"
+#include "Poco/BinaryWriter.h"
 #include "Poco/Exception.h"
 
 // tradelib headers
 #include "tradelib/Bar.h"
 #include "tradelib/Execution.h"
+#include "tradelib/Symbol.h"
 #include "tradelib/Tick.h"
 #include "tradelib/Types.h"
 
 namespace tradelib
 {
+   // Identifies an order submitted to a broker (see OrderStore)
+   typedef uint64 OrderHandle;
+   static const OrderHandle NO_ORDER = 0;
+
    class Order
    {
    public:
       // Use the position quantity when processing this order
       static const long POSITION_QUANTITY = -1;
 
-      std::string symbol;
+      // The direction in which the price must cross the trigger price
+      enum class Trigger
+      {
+         // No price condition (market orders)
+         NONE,
+         // At or above the trigger price
+         RISING,
+         // At or below the trigger price
+         FALLING
+      };
+
+      Symbol symbol;
       long quantity;
       numeric limitPrice;
       numeric stopPrice;
       numeric fillPrice;
       std::string signal;
 
-      static Order enterLong(const std::string s, long q) { return Order(s, q, NAN, NAN, Type::ENTER_LONG); }
-      static Order enterLongLimit(const std::string s, long q, numeric lp) { return Order(s, q, lp, NAN, Type::ENTER_LONG_LIMIT); }
-      static Order enterLongStop(const std::string s, long q, numeric sp) { return Order(s, q, NAN, sp, Type::ENTER_LONG_STOP); }
-      static Order enterLongStopLimit(const std::string s, long q, numeric sp, numeric lp) { return Order(s, q, sp, lp, Type::ENTER_LONG_STOP_LIMIT); }
+      static Order enterLong(const Symbol & s, long q) { return Order(s, q, NAN, NAN, Type::ENTER_LONG); }
+      static Order enterLongLimit(const Symbol & s, long q, numeric lp) { return Order(s, q, NAN, lp, Type::ENTER_LONG_LIMIT); }
+      static Order enterLongStop(const Symbol & s, long q, numeric sp) { return Order(s, q, sp, NAN, Type::ENTER_LONG_STOP); }
+      static Order enterLongStopLimit(const Symbol & s, long q, numeric sp, numeric lp) { return Order(s, q, sp, lp, Type::ENTER_LONG_STOP_LIMIT); }
 
-      static Order enterShort(const std::string s, long q) { return Order(s, q, NAN, NAN, Type::ENTER_SHORT); }
-      static Order enterShortLimit(const std::string s, long q, numeric lp) { return Order(s, q, lp, NAN, Type::ENTER_SHORT_LIMIT); }
-      static Order enterShortStop(const std::string s, long q, numeric sp) { return Order(s, q, NAN, sp, Type::ENTER_SHORT_STOP); }
-      static Order enterShortStopLimit(const std::string s, long q, numeric sp, numeric lp) { return Order(s, q, sp, lp, Type::ENTER_SHORT_STOP_LIMIT); }
+      static Order enterShort(const Symbol & s, long q) { return Order(s, q, NAN, NAN, Type::ENTER_SHORT); }
+      static Order enterShortLimit(const Symbol & s, long q, numeric lp) { return Order(s, q, NAN, lp, Type::ENTER_SHORT_LIMIT); }
+      static Order enterShortStop(const Symbol & s, long q, numeric sp) { return Order(s, q, sp, NAN, Type::ENTER_SHORT_STOP); }
+      static Order enterShortStopLimit(const Symbol & s, long q, numeric sp, numeric lp) { return Order(s, q, sp, lp, Type::ENTER_SHORT_STOP_LIMIT); }
 
-      static Order exitLong(const std::string s, long q) { return Order(s, q, NAN, NAN, Type::EXIT_LONG); }
-      static Order exitLongLimit(const std::string s, long q, numeric lp) { return Order(s, q, lp, NAN, Type::EXIT_LONG_LIMIT); }
-      static Order exitLongStop(const std::string s, long q, numeric sp) { return Order(s, q, NAN, sp, Type::EXIT_LONG_STOP); }
-      static Order exitLongStopLimit(const std::string s, long q, numeric sp, numeric lp) { return Order(s, q, sp, lp, Type::EXIT_LONG_STOP_LIMIT); }
+      static Order exitLong(const Symbol & s, long q) { return Order(s, q, NAN, NAN, Type::EXIT_LONG); }
+      static Order exitLongLimit(const Symbol & s, long q, numeric lp) { return Order(s, q, NAN, lp, Type::EXIT_LONG_LIMIT); }
+      static Order exitLongStop(const Symbol & s, long q, numeric sp) { return Order(s, q, sp, NAN, Type::EXIT_LONG_STOP); }
+      static Order exitLongStopLimit(const Symbol & s, long q, numeric sp, numeric lp) { return Order(s, q, sp, lp, Type::EXIT_LONG_STOP_LIMIT); }
 
-      static Order exitShort(const std::string s, long q) { return Order(s, q, NAN, NAN, Type::EXIT_SHORT); }
-      static Order exitShortLimit(const std::string s, long q, numeric lp) { return Order(s, q, lp, NAN, Type::EXIT_SHORT_LIMIT); }
-      static Order exitShortStop(const std::string s, long q, numeric sp) { return Order(s, q, NAN, sp, Type::EXIT_SHORT_STOP); }
-      static Order exitShortStopLimit(const std::string s, long q, numeric sp, numeric lp) { return Order(s, q, sp, lp, Type::EXIT_SHORT_STOP_LIMIT); }
+      static Order exitShort(const Symbol & s, long q) { return Order(s, q, NAN, NAN, Type::EXIT_SHORT); }
+      static Order exitShortLimit(const Symbol & s, long q, numeric lp) { return Order(s, q, NAN, lp, Type::EXIT_SHORT_LIMIT); }
+      static Order exitShortStop(const Symbol & s, long q, numeric sp) { return Order(s, q, sp, NAN, Type::EXIT_SHORT_STOP); }
+      static Order exitShortStopLimit(const Symbol & s, long q, numeric sp, numeric lp) { return Order(s, q, sp, lp, Type::EXIT_SHORT_STOP_LIMIT); }
 
       Order()
-         : quantity(LONG_MIN), barsValidFor_(-1)
+         : quantity(LONG_MIN), barsValidFor_(-1), sibling_(NO_ORDER), child_(NO_ORDER)
       {}
 
       void activate() { state_ = State::ACTIVE; }
@@ -57,6 +75,7 @@ namespace tradelib
       void cancel() { state_ = State::CANCELLED; }
 
       bool isActive() const { return state_ == State::ACTIVE; }
+      bool isPending() const { return state_ == State::PENDING; }
       bool isFilled() const { return state_ == State::FILLED; }
       bool isCancelled() const { return state_ == State::CANCELLED; }
 
@@ -101,6 +120,35 @@ namespace tradelib
        */
       void updateState(const Bar & bar);
 
+      /**
+       * @brief The price condition of the order in its current state
+       *
+       * "tryFill" has no effect (neither fills, nor changes the order) unless the tick price
+       * crosses the trigger price in the returned direction. A stop limit is triggered by
+       * the stop price, and by the limit price once stopped. An order with a NaN trigger
+       * price can't be triggered.
+       *
+       * @param price The trigger price, unchanged for Trigger::NONE
+       */
+      Trigger trigger(numeric & price) const;
+
+      // Moves the trigger price (see "trigger"), i.e. to trail a stop
+      void setTriggerPrice(numeric price);
+
+      // Order groups (see FillSimulator::submitOco and submitBracket). The orders of a
+      // one-cancels-other group form a ring through "sibling". The orders attached to a
+      // bracket entry are pending until the entry fills, "child" is one of them.
+      OrderHandle sibling() const { return sibling_; }
+      OrderHandle child() const { return child_; }
+      void setSibling(OrderHandle handle) { sibling_ = handle; }
+      void attach(OrderHandle handle) { child_ = handle; }
+      // Waits for the parent order to fill, see "activate"
+      void makePending() { state_ = State::PENDING; }
+
+      // The complete state of the order, see Checkpoint
+      void save(Poco::BinaryWriter & writer) const;
+      void load(Poco::BinaryReader & reader);
+
    protected:
       enum Type : uint
       {
@@ -168,7 +216,9 @@ namespace tradelib
       {
          ACTIVE,
          CANCELLED,
-         FILLED
+         FILLED,
+         // Attached to an order which didn't fill yet
+         PENDING
       };
 
       enum Flags : uint
@@ -177,8 +227,8 @@ namespace tradelib
          STOP_WAS_TRIGGERED = 0x0001
       };
 
-      Order(const std::string & s, long q, numeric sp, numeric lp, Order::Type t)
-         : symbol(s), quantity(q), stopPrice(sp), limitPrice(lp), fillPrice(NAN), type_(t), state_(State::ACTIVE), flags_(0), barsValidFor_(-1)
+      Order(const Symbol & s, long q, numeric sp, numeric lp, Order::Type t)
+         : symbol(s), quantity(q), stopPrice(sp), limitPrice(lp), fillPrice(NAN), type_(t), state_(State::ACTIVE), flags_(0), barsValidFor_(-1), sibling_(NO_ORDER), child_(NO_ORDER)
       {}
 
       long computeFilledQuantity(long position) const
@@ -202,6 +252,9 @@ namespace tradelib
 
       sint barsValidFor_;
       Timestamp lastBar_;
+
+      OrderHandle sibling_;
+      OrderHandle child_;
    };
 
    // The object used to notify for order executions and other events
@@ -0,0 +1,129 @@
+#ifndef ORDER_STORE_H
+#define ORDER_STORE_H
+
+// std headers
+#include <deque>
+#include <vector>
+
+// libraries headers
+#include "Poco/Bugcheck.h"
+
+// tradelib headers
+#include "tradelib/Order.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class OrderStore
+    *
+    * @brief The orders of a fill simulator, addressed by handles
+    *
+    * The orders live in slots which never move - a deque only grows at the end - so pointers
+    * to them (i.e. in OrderNotification) remain valid until the order is released. Released
+    * slots are reused, last released first.
+    *
+    * A handle is the slot in the low 32 bits and the generation of the slot in the high 32
+    * bits. The generation changes every time the slot is released, so the handle of a
+    * released order doesn't find the order which reuses the slot. Generations start at 1, a
+    * handle is never NO_ORDER.
+    */
+   class OrderStore
+   {
+   public:
+      OrderStore()
+         : free_(NO_SLOT)
+      {}
+
+      OrderHandle add(const Order & order)
+      {
+         uint32 slot;
+         if (free_ != NO_SLOT)
+         {
+            slot = free_;
+            free_ = slots_[slot].nextFree;
+            slots_[slot].order = order;
+         }
+         else
+         {
+            slot = static_cast<uint32>(slots_.size());
+            slots_.emplace_back(order);
+         }
+         slots_[slot].nextFree = IN_USE;
+         return handle(slot);
+      }
+
+      // The order, nullptr if the handle is stale (the order was released)
+      Order * find(OrderHandle h)
+      {
+         uint32 slot = static_cast<uint32>(h);
+         if (slot >= slots_.size() || slots_[slot].nextFree != IN_USE || handle(slot) != h) return nullptr;
+         return &slots_[slot].order;
+      }
+
+      Order & operator[](uint32 slot) { return slots_[slot].order; }
+      const Order & operator[](uint32 slot) const { return slots_[slot].order; }
+
+      OrderHandle handle(uint32 slot) const { return (static_cast<OrderHandle>(slots_[slot].generation) << 32) | slot; }
+      static uint32 slot(OrderHandle h) { return static_cast<uint32>(h); }
+
+      void release(uint32 slot)
+      {
+         poco_assert_dbg(slots_[slot].nextFree == IN_USE);
+         ++slots_[slot].generation;
+         if (slots_[slot].generation == 0) slots_[slot].generation = 1;
+         slots_[slot].nextFree = free_;
+         free_ = slot;
+      }
+
+      // Puts an order back under the handle it had (see Checkpoint), the slot must be free
+      void restore(OrderHandle h, const Order & order)
+      {
+         uint32 slot = static_cast<uint32>(h);
+         while (slots_.size() <= slot)
+         {
+            slots_.emplace_back(Order());
+            release(static_cast<uint32>(slots_.size() - 1));
+         }
+
+         // Unlink the slot from the free list
+         poco_assert(slots_[slot].nextFree != IN_USE);
+         uint32 * link = &free_;
+         while (*link != slot) link = &slots_[*link].nextFree;
+         *link = slots_[slot].nextFree;
+
+         slots_[slot].order = order;
+         slots_[slot].generation = static_cast<uint32>(h >> 32);
+         slots_[slot].nextFree = IN_USE;
+      }
+
+      void clear()
+      {
+         slots_.clear();
+         free_ = NO_SLOT;
+      }
+
+   protected:
+      static const uint32 NO_SLOT = 0xffffffff;
+      static const uint32 IN_USE = 0xfffffffe;
+
+      class Slot
+      {
+      public:
+         Order order;
+         uint32 generation;
+         // The next free slot, IN_USE while the slot holds an order
+         uint32 nextFree;
+
+         explicit Slot(const Order & o)
+            : order(o), generation(1), nextFree(IN_USE)
+         {}
+      };
+
+      std::deque<Slot> slots_;
+      // The head of the free slots list
+      uint32 free_;
+   };
+}
+
+#endif // ORDER_STORE_H
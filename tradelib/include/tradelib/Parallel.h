@@ -0,0 +1,121 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// std headers
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <vector>
+
+// libraries headers
+#include "Poco/AtomicCounter.h"
+#include "Poco/Environment.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+
+// tradelib headers
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class ParallelFor
+    *
+    * @brief Calls "job(ii)" for every ii in [0, count) on a set of threads
+    *
+    * The threads take the next pending index as soon as they finish one, so jobs of uneven
+    * length still keep all threads busy. "run" returns once all jobs are done and rethrows the
+    * first exception thrown by a job, in time (the threads stop taking new jobs after a
+    * failure, the jobs already running may fail too).
+    * 0 threads - one per processor.
+    */
+   template<class Job>
+   class ParallelFor
+   {
+   public:
+      ParallelFor(Job & job, sint threads = 0)
+         : job_(job), threads_(threads > 0 ? threads : Poco::Environment::processorCount()), failed_(0)
+      {}
+
+      void run(sint count)
+      {
+         count_ = count;
+         next_ = 0;
+         failed_ = 0;
+
+         sint threads = std::min<sint>(threads_, count);
+         std::vector<std::unique_ptr<Worker>> workers;
+         std::vector<std::unique_ptr<Poco::Thread>> pool;
+         for (sint ii = 0; ii < threads; ++ii)
+         {
+            workers.emplace_back(new Worker(*this));
+            pool.emplace_back(new Poco::Thread());
+            pool.back()->start(*workers.back());
+         }
+         for (auto & tt : pool) tt->join();
+
+         for (auto & ww : workers)
+         {
+            if (ww->first) std::rethrow_exception(ww->error);
+         }
+      }
+
+   protected:
+      class Worker : public Poco::Runnable
+      {
+      public:
+         explicit Worker(ParallelFor & parallelFor)
+            : first(false), parallelFor_(parallelFor)
+         {}
+
+         virtual void run()
+         {
+            try
+            {
+               parallelFor_.work();
+            }
+            catch (...)
+            {
+               error = std::current_exception();
+               // AtomicCounter::operator++ returns the incremented value
+               first = (++parallelFor_.failed_ == 1);
+            }
+         }
+
+         std::exception_ptr error;
+         // The worker that failed first
+         bool first;
+
+      protected:
+         ParallelFor & parallelFor_;
+      };
+
+      void work()
+      {
+         while (failed_ == 0)
+         {
+            // AtomicCounter::operator++ returns the incremented value
+            sint ii = (++next_) - 1;
+            if (ii >= count_) return;
+            job_(ii);
+         }
+      }
+
+      Job & job_;
+      sint threads_;
+      sint count_;
+
+      // The next job to execute
+      Poco::AtomicCounter next_;
+      Poco::AtomicCounter failed_;
+   };
+
+   // Convenience, deduces the job type
+   template<class Job>
+   void parallelFor(sint count, sint threads, Job & job)
+   {
+      ParallelFor<Job>(job, threads).run(count);
+   }
+}
+
+#endif // PARALLEL_H
@@ -2,8 +2,12 @@
 #define PINNACLE_DATA_FEED_H
 
 // std headers
+#include <functional>
 #include <map>
+#include <memory>
+#include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
 // libraries headers
@@ -11,10 +15,34 @@
 #include "Poco/JSON/Object.h"
 
 // tradelib headers
+#include "tradelib/BarPrefetcher.h"
 #include "tradelib/DataFeed.h"
 
 namespace tradelib
 {
+   /**
+    * @class PinnacleDataFeed
+    *
+    * @brief Historical futures data in the Pinnacle Data Corp CSV format
+    *
+    * The configuration is an SQLite database. The "key_value" table contains:
+    *
+    *    directory   - the directory of the bar files
+    *    suffix      - appended to the symbol to form the file name, i.e. "_REV.CSV". Files
+    *                  ending in ".gz" are decompressed on the fly, and if the plain file is
+    *                  missing, its ".gz" version is used instead.
+    *    date_format - the format of the date column, i.e. "%Y%m%d"
+    *    bar_cache   - "on" (the default) reads a fresh binary cache instead of the CSV when
+    *                  available, "build" also (re)builds missing or stale caches on subscribe,
+    *                  "off" always parses the CSV (see BarCache)
+    *    decode_threads - the number of threads decoding the bar files in the background during
+    *                  "start", 0 (the default) decodes on the replay thread (see BarPrefetcher)
+    *    prefetch_depth - the number of decoded bars queued per symbol by the decode threads,
+    *                  1024 by default
+    *    start_date  - replay only the bars from this date on ("%Y-%m-%d"). The bar files are
+    *                  entered via a sidecar index (see BarIndex), built on first use.
+    *    end_date    - replay only the bars up to this date, inclusive ("%Y-%m-%d")
+    */
    class PinnacleDataFeed : public DataFeed
    {
    public:
@@ -25,17 +53,89 @@ namespace tradelib
       virtual void unsubscribe(const std::string & symbol);
       virtual void start();
 
+      // Same as "start", but the bars go straight to "handler.onBar(const Bar & bar)" instead
+      // of barEvent. The handler is a template parameter, so the call may be inlined.
+      template<class Handler>
+      void run(Handler & handler);
+
+      PinnacleDataFeed()
+         : barCache_(BarCacheMode::ON), decodeThreads_(0), prefetchDepth_(1024), start_(TIMESTAMP_MIN), end_(TIMESTAMP_MAX)
+      {}
+
    protected:
-      typedef std::vector<BarFileReader> ReaderVector;
+      enum class BarCacheMode { OFF, ON, BUILD };
+
+      typedef std::vector<std::unique_ptr<BarReader>> ReaderVector;
       ReaderVector readers_;
 
+      std::unique_ptr<BarReader> openReader(const std::string & symbol, const std::string & path);
+      // Replays the bars of the readers in timestamp order
+      template<class Handler>
+      void merge(ReaderVector & readers, Handler & handler);
+
       Poco::Dynamic::Var parsedJson_;
       Poco::JSON::Object::Ptr jsonRoot_;
 
       Poco::Path path_;
       std::string suffix_;
       std::string format_;
+      BarCacheMode barCache_;
+      sint decodeThreads_;
+      sint prefetchDepth_;
+      // The replayed range, [start_, end_)
+      Timestamp start_;
+      Timestamp end_;
    };
+
+   template<class Handler>
+   void PinnacleDataFeed::run(Handler & handler)
+   {
+      if (decodeThreads_ > 0 && !readers_.empty())
+      {
+         // Merge pre-decoded bars while the workers decode ahead. The prefetching readers
+         // are destroyed before the prefetcher they refer to.
+         BarPrefetcher prefetcher(decodeThreads_, prefetchDepth_);
+         ReaderVector prefetching;
+         for (auto & rr : readers_) prefetching.emplace_back(prefetcher.prefetch(*rr));
+
+         prefetcher.start();
+         merge(prefetching, handler);
+      }
+      else
+      {
+         merge(readers_, handler);
+      }
+   }
+
+   template<class Handler>
+   void PinnacleDataFeed::merge(ReaderVector & readers, Handler & handler)
+   {
+      // A k-way merge of the readers. The heap holds one entry per non-empty reader, keyed on
+      // the timestamp of its next bar. Equal timestamps are ordered by the subscription order
+      // (the index of the reader), so the replay is deterministic.
+      typedef std::pair<Timestamp, sint> HeapEntry;
+      std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+
+      Timestamp timestamp;
+      for (sint ii = 0; ii < readers.size(); ++ii)
+      {
+         if (readers[ii]->peekTimestamp(timestamp)) heap.push(HeapEntry(timestamp, ii));
+      }
+
+      Bar bar;
+      while (!heap.empty())
+      {
+         sint index = heap.top().second;
+         heap.pop();
+
+         readers[index]->next(bar);
+
+         // Re-insert the reader before firing, its next bar can't precede this one
+         if (readers[index]->peekTimestamp(timestamp)) heap.push(HeapEntry(timestamp, index));
+
+         handler.onBar(bar);
+      }
+   }
 }
 
 #endif // PINNACLE_DATA_FEED_H
\ No newline at end of file
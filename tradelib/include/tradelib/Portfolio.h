@@ -2,17 +2,20 @@
 #define PORTFOLIO_H
 
 // std headers
-#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 // libraries headers
+#include "Poco/BinaryReader.h"
+#include "Poco/BinaryWriter.h"
 #include "Poco/DateTimeFormatter.h"
 #include "Poco/Timespan.h"
 
 // tradelib headers
 #include "tradelib/Instrument.h"
 #include "tradelib/Math.h"
+#include "tradelib/Symbol.h"
 #include "tradelib/Types.h"
 
 namespace tradelib
@@ -94,22 +97,31 @@ namespace tradelib
       void getPnl(const Instrument & instrument, const NumericIndexer & prices, NumericIndexer & pnl) const;
       // Add a new instrument to the portfolio
       void addInstrument(const Instrument & instrument);
+      // Add the transactions of another portfolio. The two must not have instruments in common.
+      void merge(const Portfolio & other);
+      // Remove all transactions
+      void clear() { data_.clear(); }
+      // All transactions, see Checkpoint. Loading replaces the current transactions.
+      void save(Poco::BinaryWriter & writer) const;
+      void load(Poco::BinaryReader & reader);
       // Get the per-trade statistics for an instrument
       void getTradeStats(const Instrument & instrument, TradeStatsVector & tradeStats) const;
       void getTradeStats(const Instrument & instrument, const NumericIndexer & pnl, TradeStatsVector & tradeStats, TradeSummary & all, TradeSummary & longs, TradeSummary & shorts) const;
+      // Summarize a set of trades (i.e. a subset of the trades of an instrument), given the PnL
+      static void summarizeTrades(const TradeStatsVector & tradeStats, const NumericIndexer & pnl, TradeSummary & all, TradeSummary & longs, TradeSummary & shorts);
 
       const std::string & name() const { return name_; }
 
       // The next set of functions get the attributes of the last transaction
-      long quantity(const std::string & symbol) const { return data_.find(symbol)->second.back().quantity; }
-      numeric price(const std::string & symbol) const { return data_.find(symbol)->second.back().price; }
-      numeric averageCost(const std::string & symbol) const { return data_.find(symbol)->second.back().averageCost; }
-      long positionQuantity(const std::string & symbol) const { return data_.find(symbol)->second.back().positionQuantity; }
-      numeric positionAverageCost(const std::string & symbol) const { return data_.find(symbol)->second.back().positionAverageCost; }
-      numeric grossPnl(const std::string & symbol) const { return data_.find(symbol)->second.back().grossPnl; }
-      numeric netPnl(const std::string & symbol) const { return data_.find(symbol)->second.back().netPnl; }
-      numeric fees(const std::string & symbol) const { return data_.find(symbol)->second.back().fees; }
-      numeric value(const std::string & symbol) const { return data_.find(symbol)->second.back().value; }
+      long quantity(const Symbol & symbol) const { return find(symbol)->back().quantity; }
+      numeric price(const Symbol & symbol) const { return find(symbol)->back().price; }
+      numeric averageCost(const Symbol & symbol) const { return find(symbol)->back().averageCost; }
+      long positionQuantity(const Symbol & symbol) const { return find(symbol)->back().positionQuantity; }
+      numeric positionAverageCost(const Symbol & symbol) const { return find(symbol)->back().positionAverageCost; }
+      numeric grossPnl(const Symbol & symbol) const { return find(symbol)->back().grossPnl; }
+      numeric netPnl(const Symbol & symbol) const { return find(symbol)->back().netPnl; }
+      numeric fees(const Symbol & symbol) const { return find(symbol)->back().fees; }
+      numeric value(const Symbol & symbol) const { return find(symbol)->back().value; }
 
    protected:
       class Transaction
@@ -155,12 +167,24 @@ namespace tradelib
          const Transaction & back() const { return container_.back(); }
          const Transaction & front() const { return container_.front(); }
 
+         void save(Poco::BinaryWriter & writer) const;
+         void load(Poco::BinaryReader & reader);
+
       private:
          ContainerType container_;
       };
 
+      // The transactions of a symbol, nullptr if there are none
+      const TransactionCollection * find(const Symbol & symbol) const
+      {
+         return symbol.id() < data_.size() ? data_[symbol.id()].get() : nullptr;
+      }
+
+      TransactionCollection & findOrAdd(const Symbol & symbol);
+
       std::string name_;
-      std::map<std::string, TransactionCollection> data_;
+      // Indexed by the symbol id
+      std::vector<std::unique_ptr<TransactionCollection>> data_;
 
       friend std::ostream & operator<<(std::ostream &, const Transaction &);
    };
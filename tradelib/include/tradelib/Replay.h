@@ -0,0 +1,127 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// std headers
+#include <string>
+#include <utility>
+
+// tradelib headers
+#include "tradelib/Broker.h"
+#include "tradelib/FillSimulator.h"
+#include "tradelib/Strategy.h"
+
+namespace tradelib
+{
+   /**
+    * @class Replay
+    *
+    * @brief A historical replay with the feed and the strategy bound at compile time
+    *
+    * The counterpart of HistoricalReplay for runs where the types are known up front, i.e.
+    * parameter sweeps. The feed (i.e. PinnacleDataFeed) must provide "run(Handler &)", the
+    * strategy (derived from Strategy) is owned by the replay and constructed in place:
+    *
+    *    PinnacleDataFeed feed;
+    *    feed.configure(config);
+    *    Replay<PinnacleDataFeed, MyStrategy> replay(feed, fastLength, slowLength);
+    *    replay.subscribe("ES");
+    *    replay.start();
+    *
+    * The bars go from the feed through the fill simulator to the strategy handlers without
+    * events or virtual calls - the strategy's dynamic type is known, so its "on*" methods can
+    * be inlined too. The Broker events still fire (after the strategy), so additional observers
+    * work as with HistoricalReplay. The strategy's orders go through Broker::submitOrder.
+    *
+    * The strategy constructor receives the replay (as its Broker) followed by "args".
+    */
+   template<class Feed, class S>
+   class Replay : public Broker
+   {
+   public:
+      template<class... Args>
+      Replay(Feed & feed, Args &&... args)
+         : feed_(feed), simulator_(&feed), strategy_(this, std::forward<Args>(args)...)
+      {
+         // The strategy is called directly
+         Strategy * strategy = &strategy_;
+         barOpenEvent.disconnect(strategy);
+         barCloseEvent.disconnect(strategy);
+         barClosedEvent.disconnect(strategy);
+         orderNotificationEvent.disconnect(strategy);
+      }
+
+      // The Broker interface implementation
+      virtual void start() { feed_.run(*this); }
+      virtual void subscribe(const std::string & symbol) { feed_.subscribe(symbol); }
+      virtual void unsubscribe(const std::string & symbol) { feed_.unsubscribe(symbol); }
+      virtual OrderHandle submitOrder(const Order & order) { return simulator_.submitOrder(order); }
+      virtual bool cancelOrder(OrderHandle handle) { return simulator_.cancelOrder(handle); }
+      virtual bool modifyOrder(OrderHandle handle, numeric price) { return simulator_.modifyOrder(handle, price); }
+      virtual void submitOco(const Order & first, const Order & second, OrderHandle & firstHandle, OrderHandle & secondHandle)
+      {
+         simulator_.submitOco(first, second, firstHandle, secondHandle);
+      }
+      virtual void submitBracket(
+               const Order & entry,
+               const Order & target,
+               const Order & stop,
+               OrderHandle & entryHandle,
+               OrderHandle & targetHandle,
+               OrderHandle & stopHandle)
+      {
+         simulator_.submitBracket(entry, target, stop, entryHandle, targetHandle, stopHandle);
+      }
+      virtual const InstrumentPosition * getInstrumentPosition(const Symbol & symbol) { return simulator_.getInstrumentPosition(symbol); }
+      virtual const InstrumentVariation * getInstrumentVariation(const std::string & provider, const std::string & symbol) { return feed_.getInstrumentVariation(provider, symbol); }
+      virtual const Instrument * getInstrument(const std::string & symbol) { return feed_.getInstrument(symbol); }
+
+      // Portfolio interface
+      virtual const Portfolio * getPortfolio(const std::string & portfolio) { return &simulator_.portfolio(); }
+      virtual void getPositionPnl(const std::string & symbol, numeric price, numeric & realized, numeric & unrealized)
+      {
+         const Instrument * instrument = getInstrument(symbol);
+         // The caller must ensure that there is a position
+         poco_check_ptr(instrument);
+         simulator_.portfolio().getPositionPnl(*instrument, price, realized, unrealized);
+      }
+
+      S & strategy() { return strategy_; }
+      // The orders, the positions and the portfolio, i.e. for Checkpoint
+      FillSimulator & simulator() { return simulator_; }
+
+      // The feed handler
+      void onBar(const Bar & bar) { simulator_.processBar(bar, *this); }
+
+      // The fill simulator handler
+      void onBarOpen(const Bar & bar)
+      {
+         strategy_.Strategy::barOpenHandler(this, bar);
+         barOpenEvent(this, bar);
+      }
+
+      void onBarClose(const Bar & bar)
+      {
+         strategy_.Strategy::barCloseHandler(this, bar);
+         barCloseEvent(this, bar);
+      }
+
+      void onBarClosed(const Bar & bar)
+      {
+         strategy_.Strategy::barClosedHandler(this, bar);
+         barClosedEvent(this, bar);
+      }
+
+      void onOrderNotification(const OrderNotification & on)
+      {
+         strategy_.Strategy::orderNotificationHandler(this, on);
+         orderNotificationEvent(this, on);
+      }
+
+   protected:
+      Feed & feed_;
+      FillSimulator simulator_;
+      S strategy_;
+   };
+}
+
+#endif // REPLAY_H
@@ -0,0 +1,114 @@
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+// std headers
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// libraries headers
+#include "Poco/BinaryReader.h"
+#include "Poco/BinaryWriter.h"
+
+// tradelib headers
+#include "tradelib/Symbol.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   // The binary encoding of the values making up the state of a replay (see Checkpoint).
+   // Symbols are written by name - the ids depend on the order of interning, which
+   // changes from one process to the next.
+
+   inline void serialize(Poco::BinaryWriter & writer, const Symbol & symbol)
+   {
+      writer << symbol.name();
+   }
+
+   inline void deserialize(Poco::BinaryReader & reader, Symbol & symbol)
+   {
+      std::string name;
+      reader >> name;
+      symbol = Symbol(name);
+   }
+
+   inline void serialize(Poco::BinaryWriter & writer, Timestamp timestamp)
+   {
+      writer << static_cast<Poco::Int64>(timestamp.epochMicroseconds());
+   }
+
+   inline void deserialize(Poco::BinaryReader & reader, Timestamp & timestamp)
+   {
+      Poco::Int64 microseconds;
+      reader >> microseconds;
+      timestamp = Timestamp(microseconds);
+   }
+
+   inline void serialize(Poco::BinaryWriter & writer, Timespan timespan)
+   {
+      writer << static_cast<Poco::Int64>(timespan.totalMicroseconds());
+   }
+
+   inline void deserialize(Poco::BinaryReader & reader, Timespan & timespan)
+   {
+      Poco::Int64 microseconds;
+      reader >> microseconds;
+      timespan = Timespan(microseconds);
+   }
+
+   // Vectors of arithmetic values are written as one block, in the native byte order.
+   // RVectors are read back without notifying their observers.
+   template<class T, class A>
+   void serialize(Poco::BinaryWriter & writer, const std::vector<T, A> & values)
+   {
+      static_assert(std::is_arithmetic<T>::value, "only vectors of arithmetic values are serialized as a block");
+      writer << static_cast<Poco::UInt64>(values.size());
+      if (!values.empty()) writer.writeRaw(reinterpret_cast<const char *>(values.data()), values.size()*sizeof(T));
+   }
+
+   template<class T, class A>
+   void deserialize(Poco::BinaryReader & reader, std::vector<T, A> & values)
+   {
+      static_assert(std::is_arithmetic<T>::value, "only vectors of arithmetic values are serialized as a block");
+      Poco::UInt64 size = 0;
+      reader >> size;
+      values.resize(static_cast<size_t>(size));
+      if (!values.empty()) reader.readRaw(reinterpret_cast<char *>(values.data()), values.size()*sizeof(T));
+   }
+
+   template<class A>
+   void serialize(Poco::BinaryWriter & writer, const std::vector<Timestamp, A> & values)
+   {
+      writer << static_cast<Poco::UInt64>(values.size());
+      for (auto & tt : values) serialize(writer, tt);
+   }
+
+   template<class A>
+   void deserialize(Poco::BinaryReader & reader, std::vector<Timestamp, A> & values)
+   {
+      Poco::UInt64 size = 0;
+      reader >> size;
+      values.resize(static_cast<size_t>(size));
+      for (auto & tt : values) deserialize(reader, tt);
+   }
+
+   // The values held and the count of the dropped ones - not the window, which is set up
+   // by the owner
+   template<class T, class A>
+   void serialize(Poco::BinaryWriter & writer, const RVector<T, A> & values)
+   {
+      serialize(writer, static_cast<const std::vector<T, A> &>(values));
+      writer << static_cast<Poco::UInt64>(values.dropped());
+   }
+
+   template<class T, class A>
+   void deserialize(Poco::BinaryReader & reader, RVector<T, A> & values)
+   {
+      deserialize(reader, static_cast<std::vector<T, A> &>(values));
+      Poco::UInt64 dropped = 0;
+      reader >> dropped;
+      values.setDropped(dropped);
+   }
+}
+
+#endif // SERIALIZATION_H
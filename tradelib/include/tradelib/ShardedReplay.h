@@ -0,0 +1,163 @@
+#ifndef SHARDED_REPLAY_H
+#define SHARDED_REPLAY_H
+
+// std headers
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+// tradelib headers
+#include "tradelib/Execution.h"
+#include "tradelib/MarketData.h"
+#include "tradelib/Order.h"
+#include "tradelib/Parallel.h"
+#include "tradelib/Portfolio.h"
+#include "tradelib/Replay.h"
+
+namespace tradelib
+{
+   /**
+    * @class ShardedReplay
+    *
+    * @brief A single backtest with its symbols split over several threads
+    *
+    * The symbols of the MarketData are dealt round-robin into shards. Every shard is a complete
+    * Replay<MarketDataFeed, S> - feed, fill simulator, portfolio and its own strategy instance,
+    * constructed with (Broker *, const P &) - replaying only its symbols, and the shards run in
+    * parallel. Afterwards the portfolios are merged and so are the fills, ordered by day, then
+    * by the order of the symbols in the MarketData, then as they occurred - the same order as
+    * a single replay of daily bars, regardless of the number of shards.
+    *
+    * Only strategies declaring themselves symbol independent (Strategy::isSymbolIndependent)
+    * are sharded, the others are replayed in a single shard.
+    */
+   template<class S, class P>
+   class ShardedReplay
+   {
+   public:
+      class Fill
+      {
+      public:
+         Order order;
+         Execution execution;
+
+         Fill(const Order & o, const Execution & e)
+            : order(o), execution(e)
+         {}
+      };
+
+      typedef std::vector<Fill> FillVector;
+
+      // 0 shards - one per processor
+      ShardedReplay(std::shared_ptr<const MarketData> data, const P & parameters, sint shards = 0);
+
+      // Replays the data, once
+      void run();
+
+      sint shards() const { return shards_.size(); }
+      S & strategy(sint shard) { return shards_[shard]->replay.strategy(); }
+
+      // Available after "run"
+      const Portfolio & portfolio() const { return portfolio_; }
+      const FillVector & fills() const { return fills_; }
+
+   protected:
+      class Shard
+      {
+      public:
+         Shard(std::shared_ptr<const MarketData> data, const P & parameters)
+            : feed(data), replay(feed, parameters)
+         {
+            replay.orderNotificationEvent.template connect<Shard, &Shard::orderNotificationHandler>(this);
+         }
+
+         void orderNotificationHandler(const OrderNotification & on) { fills.emplace_back(*on.order, *on.execution); }
+
+         MarketDataFeed feed;
+         Replay<MarketDataFeed, S> replay;
+         FillVector fills;
+      };
+
+      class Job
+      {
+      public:
+         explicit Job(ShardedReplay & shardedReplay)
+            : shardedReplay_(shardedReplay)
+         {}
+
+         void operator()(sint shard) { shardedReplay_.shards_[shard]->replay.start(); }
+
+      protected:
+         ShardedReplay & shardedReplay_;
+      };
+
+      // Days since the epoch, rounded down
+      static sint64 dayOf(Timestamp timestamp)
+      {
+         sint64 microseconds = timestamp.epochMicroseconds();
+         sint64 day = microseconds / Timespan::DAYS;
+         return microseconds % Timespan::DAYS < 0 ? day - 1 : day;
+      }
+
+      std::shared_ptr<const MarketData> data_;
+      std::vector<std::unique_ptr<Shard>> shards_;
+
+      Portfolio portfolio_;
+      FillVector fills_;
+   };
+
+   template<class S, class P>
+   ShardedReplay<S, P>::ShardedReplay(std::shared_ptr<const MarketData> data, const P & parameters, sint shards)
+      : data_(data)
+   {
+      const std::vector<std::string> & symbols = data_->symbols();
+      shards_.emplace_back(new Shard(data_, parameters));
+
+      sint count = 1;
+      if (shards_.front()->replay.strategy().isSymbolIndependent())
+      {
+         count = shards > 0 ? shards : Poco::Environment::processorCount();
+         count = std::max<sint>(1, std::min<sint>(count, symbols.size()));
+      }
+      while (shards_.size() < count) shards_.emplace_back(new Shard(data_, parameters));
+
+      for (sint ii = 0; ii < symbols.size(); ++ii) shards_[ii % count]->replay.subscribe(symbols[ii]);
+   }
+
+   template<class S, class P>
+   void ShardedReplay<S, P>::run()
+   {
+      Job job(*this);
+      parallelFor(shards_.size(), shards_.size(), job);
+
+      portfolio_.clear();
+      fills_.clear();
+
+      // The position of each symbol in the MarketData, by symbol id
+      std::vector<sint> symbolOrder;
+      for (sint ii = 0; ii < data_->symbols().size(); ++ii)
+      {
+         uint32 id = data_->instruments()[ii].symbol().id();
+         if (id >= symbolOrder.size()) symbolOrder.resize(id + 1, 0);
+         symbolOrder[id] = ii;
+      }
+
+      for (auto & ss : shards_)
+      {
+         portfolio_.merge(*ss->replay.getPortfolio("default"));
+         fills_.insert(fills_.end(), ss->fills.begin(), ss->fills.end());
+      }
+
+      // Within a shard the fills are already in order, a stable sort keeps it
+      std::stable_sort(fills_.begin(), fills_.end(), [&](const Fill & left, const Fill & right)
+      {
+         sint64 leftDay = dayOf(left.execution.timestamp);
+         sint64 rightDay = dayOf(right.execution.timestamp);
+         if (leftDay != rightDay) return leftDay < rightDay;
+         return symbolOrder[left.execution.symbol.id()] < symbolOrder[right.execution.symbol.id()];
+      });
+   }
+}
+
+#endif // SHARDED_REPLAY_H
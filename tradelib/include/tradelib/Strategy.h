@@ -1,10 +1,16 @@
 #ifndef STRATEGY_H
 #define STRATEGY_H
 
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "Poco/BinaryReader.h"
+#include "Poco/BinaryWriter.h"
 #include "Poco/Delegate.h"
 
+#include "tradelib/BarSpill.h"
 #include "tradelib/Broker.h"
 #include "tradelib/Types.h"
 
@@ -20,18 +26,61 @@ namespace tradelib
       Strategy(Broker * broker)
          : broker_(broker)
       {
-         broker_->barClosedEvent += Poco::delegate(this, &Strategy::barClosedHandler);
-         broker_->barCloseEvent += Poco::delegate(this, &Strategy::barCloseHandler);
-         broker_->barOpenEvent += Poco::delegate(this, &Strategy::barOpenHandler);
-         broker_->orderNotificationEvent += Poco::delegate(this, &Strategy::orderNotificationHandler);
+         broker_->barClosedEvent.connect<Strategy, &Strategy::barClosedHandler>(this);
+         broker_->barCloseEvent.connect<Strategy, &Strategy::barCloseHandler>(this);
+         broker_->barOpenEvent.connect<Strategy, &Strategy::barOpenHandler>(this);
+         broker_->orderNotificationEvent.connect<Strategy, &Strategy::orderNotificationHandler>(this);
       }
 
       ~Strategy()
       {
-         broker_->barClosedEvent.clear();
-         broker_->barCloseEvent.clear();
-         broker_->barOpenEvent.clear();
-         broker_->orderNotificationEvent.clear();
+         broker_->barClosedEvent.disconnect(this);
+         broker_->barCloseEvent.disconnect(this);
+         broker_->barOpenEvent.disconnect(this);
+         broker_->orderNotificationEvent.disconnect(this);
+      }
+
+      // "true" if the strategy treats every symbol on its own - no state shared between symbols
+      // and no orders for a symbol based on another one's bars. Such a strategy can be replayed
+      // with its symbols split over several threads (see ShardedReplay).
+      virtual bool isSymbolIndependent() const { return false; }
+
+      // The bars the strategy looks back, including its indicators. The histories keep that
+      // many bars (up to twice as many in memory) and drop the older ones, see
+      // BarHistory::setWindow. 0 - keep all the bars, the default. Applies to the histories
+      // started afterwards, so declare it in the constructor.
+      void setLookback(sint bars) { lookback_ = bars; }
+      sint lookback() const { return lookback_; }
+
+      // Raises the lookback to "bars", if below
+      void requireLookback(sint bars) { lookback_ = std::max(lookback_, bars); }
+
+      // Raises the lookback to what an indicator fed from the histories reads (i.e. SMA): its
+      // length and the value leaving its window
+      template<class Indicator>
+      void requireLookback() { requireLookback(static_cast<sint>(Indicator::length) + 1); }
+
+      // The lookback of a single history, instead of the one above
+      void setLookback(const Symbol & symbol, Timespan timespan, sint bars)
+      {
+         barHistories_.lookupOrAdd(symbol, timespan)->setWindow(bars);
+      }
+
+      // Writes the bars a history drops to "path", for the analytics needing the full history,
+      // see BarSpill
+      BarSpill & spillHistory(const Symbol & symbol, Timespan timespan, const std::string & path);
+
+      // The bar histories and the strategy's own state (see saveState), see Checkpoint
+      void save(Poco::BinaryWriter & writer) const
+      {
+         barHistories_.save(writer);
+         saveState(writer);
+      }
+
+      void load(Poco::BinaryReader & reader)
+      {
+         barHistories_.load(reader);
+         loadState(reader);
       }
 
       // Db interface
@@ -40,11 +89,36 @@ namespace tradelib
       const std::string & getDb() const { return dbPath_; }
 
    protected:
-      // The handlers for the Broker events
-      void barOpenHandler(const void * sender, const Bar & bar);
-      void barCloseHandler(const void * sender, const Bar & bar);
-      void barClosedHandler(const void * sender, const Bar & bar);
-      void orderNotificationHandler(const void * sender, const OrderNotification & on);
+      // The handlers for the Broker events. Inline, so that Replay can compile the strategy
+      // into its per-bar path.
+      void barOpenHandler(const void * sender, const Bar & bar)
+      {
+         BarHistory * history = barHistories_.lookup(bar.symbol, bar.timespan);
+         poco_check_ptr(history);
+         onBarOpen(*history, bar);
+      }
+
+      void barCloseHandler(const void * sender, const Bar & bar)
+      {
+         BarHistory * history = barHistories_.lookupOrAdd(bar.symbol, bar.timespan);
+         // A history without a lookback of its own gets the strategy's one
+         if (lookback_ > 0 && history->close.window() == 0) history->setWindow(lookback_);
+         history->append(bar);
+         onBarClose(*history, bar);
+      }
+
+      void barClosedHandler(const void * sender, const Bar & bar)
+      {
+         BarHistory * history = barHistories_.lookup(bar.symbol, bar.timespan);
+         poco_check_ptr(history);
+         onBarClosed(*history, bar);
+      }
+
+      void orderNotificationHandler(const void * sender, const OrderNotification & on)
+      {
+         logExecution(on);
+         onOrderNotification(on);
+      }
 
       // Virtual methods, to be overwritten by strategy implementations:
       virtual void onBarOpen(const BarHistory & history, const Bar & bar) {}
@@ -52,29 +126,53 @@ namespace tradelib
       virtual void onBarClosed(const BarHistory & history, const Bar & bar) {}
       virtual void onOrderNotification(const OrderNotification & on) {}
 
-      // Order management
-      void enterLong(const std::string & symbol, long quantity = 1);
-      void enterLongLimit(const std::string & symbol, numeric limitPrice, long quantity = 1);
-      void enterLongStop(const std::string & symbol, numeric stopPrice, long quantity = 1);
-      void enterLongStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity = 1);
+      // The state kept by the implementation (indicators, counters and such), so that a
+      // loaded strategy continues as if it had processed the bars itself
+      virtual void saveState(Poco::BinaryWriter & writer) const {}
+      virtual void loadState(Poco::BinaryReader & reader) {}
 
-      void exitLong(const std::string & symbol, long quantity = -1);
-      void exitLongLimit(const std::string & symbol, numeric limitPrice, long quantity = -1);
-      void exitLongStop(const std::string & symbol, numeric stopPrice, long quantity = -1);
-      void exitLongStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity = -1);
+      // Order management. The handles are for cancelOrder and modifyOrder.
+      OrderHandle enterLong(const Symbol & symbol, long quantity = 1);
+      OrderHandle enterLongLimit(const Symbol & symbol, numeric limitPrice, long quantity = 1);
+      OrderHandle enterLongStop(const Symbol & symbol, numeric stopPrice, long quantity = 1);
+      OrderHandle enterLongStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity = 1);
 
-      void enterShort(const std::string & symbol, long quantity = 1);
-      void enterShortLimit(const std::string & symbol, numeric limitPrice, long quantity = 1);
-      void enterShortStop(const std::string & symbol, numeric stopPrice, long quantity = 1);
-      void enterShortStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity = 1);
+      OrderHandle exitLong(const Symbol & symbol, long quantity = -1);
+      OrderHandle exitLongLimit(const Symbol & symbol, numeric limitPrice, long quantity = -1);
+      OrderHandle exitLongStop(const Symbol & symbol, numeric stopPrice, long quantity = -1);
+      OrderHandle exitLongStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity = -1);
 
-      void exitShort(const std::string & symbol, long quantity = -1);
-      void exitShortLimit(const std::string & symbol, numeric limitPrice, long quantity = -1);
-      void exitShortStop(const std::string & symbol, numeric stopPrice, long quantity = -1);
-      void exitShortStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity = -1);
+      OrderHandle enterShort(const Symbol & symbol, long quantity = 1);
+      OrderHandle enterShortLimit(const Symbol & symbol, numeric limitPrice, long quantity = 1);
+      OrderHandle enterShortStop(const Symbol & symbol, numeric stopPrice, long quantity = 1);
+      OrderHandle enterShortStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity = 1);
 
-      void enterLongStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity, uint barsValidFor);
-      void enterShortStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity, uint barsValidFor);
+      OrderHandle exitShort(const Symbol & symbol, long quantity = -1);
+      OrderHandle exitShortLimit(const Symbol & symbol, numeric limitPrice, long quantity = -1);
+      OrderHandle exitShortStop(const Symbol & symbol, numeric stopPrice, long quantity = -1);
+      OrderHandle exitShortStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity = -1);
+
+      OrderHandle enterLongStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity, uint barsValidFor);
+      OrderHandle enterShortStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity, uint barsValidFor);
+
+      bool cancelOrder(OrderHandle handle) { return broker_->cancelOrder(handle); }
+      bool modifyOrder(OrderHandle handle, numeric price) { return broker_->modifyOrder(handle, price); }
+
+      // Order groups, the orders are built with the Order factories (Order::exitLongStop and such)
+      void submitOco(const Order & first, const Order & second, OrderHandle & firstHandle, OrderHandle & secondHandle)
+      {
+         broker_->submitOco(first, second, firstHandle, secondHandle);
+      }
+      void submitBracket(
+               const Order & entry,
+               const Order & target,
+               const Order & stop,
+               OrderHandle & entryHandle,
+               OrderHandle & targetHandle,
+               OrderHandle & stopHandle)
+      {
+         broker_->submitBracket(entry, target, stop, entryHandle, targetHandle, stopHandle);
+      }
 
       // Db interface
       void logExecution(const OrderNotification & on);
@@ -82,7 +180,11 @@ namespace tradelib
 
       Broker * broker_;
       BarHistories barHistories_;
+      sint lookback_ = 0;
+      std::vector<std::unique_ptr<BarSpill>> spills_;
       std::string dbPath_;
+
+      template<class Feed, class S> friend class Replay;
    };
 }
 
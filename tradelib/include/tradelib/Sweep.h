@@ -0,0 +1,145 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+// std headers
+#include <memory>
+#include <vector>
+
+// tradelib headers
+#include "tradelib/MarketData.h"
+#include "tradelib/Parallel.h"
+#include "tradelib/Portfolio.h"
+#include "tradelib/Replay.h"
+#include "tradelib/Trace.h"
+
+namespace tradelib
+{
+   /**
+    * @class Sweep
+    *
+    * @brief Runs a strategy over a set of parameters in parallel
+    *
+    * Every run is an independent Replay<MarketDataFeed, S> - its own feed, fill simulator,
+    * portfolio and strategy - over the same shared, read-only MarketData, so the bars are
+    * loaded once for the whole sweep. The strategy is constructed with (Broker *, const P &).
+    *
+    *    std::shared_ptr<const MarketData> data(new MarketData(feed, symbols));
+    *    Sweep<MyStrategy, MyParameters> sweep(data);
+    *    for (...) sweep.add(MyParameters(...));
+    *    Sweep<MyStrategy, MyParameters>::ResultVector results;
+    *    sweep.run(results);
+    *
+    * The runs are spread over the threads by ParallelFor. The results don't depend on the number
+    * of threads: one per (run, symbol), ordered by run, then by the order of the symbols in the
+    * MarketData.
+    *
+    * The strategies run concurrently and must not share mutable state.
+    *
+    * With a trace capacity set, every run records its order lifecycle into its own Trace,
+    * kept after the sweep for "trace".
+    */
+   template<class S, class P>
+   class Sweep
+   {
+   public:
+      class Result
+      {
+      public:
+         // The index of the parameters, in the order of "add"
+         sint run;
+         Symbol symbol;
+         TradeSummary all;
+         TradeSummary longs;
+         TradeSummary shorts;
+      };
+
+      typedef std::vector<Result> ResultVector;
+
+      // 0 threads - one per processor
+      Sweep(std::shared_ptr<const MarketData> data, sint threads = 0)
+         : data_(data), threads_(threads), traceCapacity_(0)
+      {}
+
+      void add(const P & parameters) { parameters_.push_back(parameters); }
+
+      const std::vector<P> & parameters() const { return parameters_; }
+
+      // 0 - no traces (the default)
+      void setTraceCapacity(uint32 capacity) { traceCapacity_ = capacity; }
+      // The trace of a run of the last sweep, nullptr if not traced
+      const Trace * trace(sint run) const { return run < traces_.size() ? traces_[run].get() : nullptr; }
+
+      void run(ResultVector & results);
+
+   protected:
+      class Job
+      {
+      public:
+         explicit Job(Sweep & sweep)
+            : sweep_(sweep)
+         {}
+
+         void operator()(sint run) { sweep_.runOne(run, sweep_.runResults_[run]); }
+
+      protected:
+         Sweep & sweep_;
+      };
+
+      void runOne(sint run, ResultVector & results);
+
+      std::shared_ptr<const MarketData> data_;
+      sint threads_;
+      std::vector<P> parameters_;
+      uint32 traceCapacity_;
+      std::vector<std::unique_ptr<Trace>> traces_;
+
+      // The results of each run, filled in by the worker executing it
+      std::vector<ResultVector> runResults_;
+   };
+
+   template<class S, class P>
+   void Sweep<S, P>::run(ResultVector & results)
+   {
+      runResults_.assign(parameters_.size(), ResultVector());
+      traces_.clear();
+      traces_.resize(parameters_.size());
+      if (traceCapacity_ > 0)
+      {
+         for (auto & tt : traces_) tt.reset(new Trace(traceCapacity_));
+      }
+
+      Job job(*this);
+      parallelFor(parameters_.size(), threads_, job);
+
+      results.clear();
+      for (auto & rr : runResults_) results.insert(results.end(), rr.begin(), rr.end());
+      runResults_.clear();
+   }
+
+   template<class S, class P>
+   void Sweep<S, P>::runOne(sint run, ResultVector & results)
+   {
+      MarketDataFeed feed(data_);
+      Replay<MarketDataFeed, S> replay(feed, parameters_[run]);
+      replay.simulator().setTrace(traces_[run].get());
+      for (auto & ss : data_->symbols()) replay.subscribe(ss);
+      replay.start();
+
+      const Portfolio * portfolio = replay.getPortfolio("default");
+      for (auto & instrument : data_->instruments())
+      {
+         Result result;
+         result.run = run;
+         result.symbol = instrument.symbol();
+         result.all = result.longs = result.shorts = TradeSummary();
+
+         NumericIndexer pnl;
+         TradeStatsVector tradeStats;
+         portfolio->getPnl(instrument, data_->closes(instrument.symbol()), pnl);
+         portfolio->getTradeStats(instrument, pnl, tradeStats, result.all, result.longs, result.shorts);
+         results.push_back(result);
+      }
+   }
+}
+
+#endif // SWEEP_H
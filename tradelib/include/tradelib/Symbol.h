@@ -0,0 +1,114 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+// std headers
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// libraries headers
+#include "Poco/Mutex.h"
+
+// tradelib headers
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   /**
+    * @class SymbolTable
+    *
+    * @brief Assigns dense integer ids to symbol names
+    *
+    * Ids are never recycled and start at 0, which is the empty symbol. Interning takes a lock,
+    * looking up the name of an id doesn't - names are kept in fixed-size chunks which never
+    * move once allocated.
+    */
+   class SymbolTable
+   {
+   public:
+      static SymbolTable & instance();
+
+      uint32 intern(const std::string & name);
+      const std::string & name(uint32 id) const { return chunks_[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)]; }
+
+      // The number of ids handed out so far, the ids are [0, size())
+      uint32 size() const;
+
+   protected:
+      static const uint32 CHUNK_BITS = 10;
+      static const uint32 CHUNK_SIZE = 1 << CHUNK_BITS;
+      static const uint32 MAX_CHUNKS = 1024;
+
+      SymbolTable();
+
+      mutable Poco::FastMutex mutex_;
+      std::unordered_map<std::string, uint32> ids_;
+      std::unique_ptr<std::string[]> chunks_[MAX_CHUNKS];
+      uint32 size_;
+   };
+
+   /**
+    * @class Symbol
+    *
+    * @brief An interned symbol name
+    *
+    * Copying and comparing a symbol is copying and comparing an integer, which is also
+    * the index used by the per-symbol tables (see HistoricalReplay, Portfolio). Converts
+    * implicitly from and to std::string, so it can stand in for the name where one is expected.
+    *
+    * The ordering (operator<) is the order of interning, not the alphabetical one.
+    */
+   class Symbol
+   {
+   public:
+      Symbol()
+         : id_(0)
+      {}
+
+      Symbol(const std::string & name)
+         : id_(SymbolTable::instance().intern(name))
+      {}
+
+      Symbol(const char * name)
+         : id_(SymbolTable::instance().intern(name))
+      {}
+
+      uint32 id() const { return id_; }
+      const std::string & name() const { return SymbolTable::instance().name(id_); }
+      bool empty() const { return id_ == 0; }
+
+      operator const std::string & () const { return name(); }
+
+      bool operator==(const Symbol & other) const { return id_ == other.id_; }
+      bool operator!=(const Symbol & other) const { return id_ != other.id_; }
+      bool operator<(const Symbol & other) const { return id_ < other.id_; }
+
+   private:
+      uint32 id_;
+   };
+
+   // Comparisons with plain names don't intern the name
+   inline bool operator==(const Symbol & symbol, const std::string & name) { return symbol.name() == name; }
+   inline bool operator==(const std::string & name, const Symbol & symbol) { return symbol.name() == name; }
+   inline bool operator==(const Symbol & symbol, const char * name) { return symbol.name() == name; }
+   inline bool operator==(const char * name, const Symbol & symbol) { return symbol.name() == name; }
+   inline bool operator!=(const Symbol & symbol, const std::string & name) { return !(symbol == name); }
+   inline bool operator!=(const std::string & name, const Symbol & symbol) { return !(symbol == name); }
+   inline bool operator!=(const Symbol & symbol, const char * name) { return !(symbol == name); }
+   inline bool operator!=(const char * name, const Symbol & symbol) { return !(symbol == name); }
+
+   std::ostream & operator<<(std::ostream & os, const Symbol & symbol);
+}
+
+namespace std
+{
+   template<>
+   struct hash<tradelib::Symbol>
+   {
+      size_t operator()(const tradelib::Symbol & symbol) const { return symbol.id(); }
+   };
+}
+
+#endif // SYMBOL_H
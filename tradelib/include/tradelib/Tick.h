@@ -7,6 +7,7 @@
 // libraries headers
 
 // tradelib headers
+#include "tradelib/Symbol.h"
 #include "Types.h"
 
 namespace tradelib
@@ -14,16 +15,16 @@ namespace tradelib
    class Tick
    {
    public:
-      std::string symbol;
+      Symbol symbol;
       Timestamp timestamp;
       numeric price;
       ulong volume;
 
-      Tick(const std::string & s, Timestamp t, numeric p, ulong v)
+      Tick(const Symbol & s, Timestamp t, numeric p, ulong v)
          : symbol(s), timestamp(t), price(p), volume(v)
       {}
 
-      Tick(const std::string & s, Timestamp t, numeric p)
+      Tick(const Symbol & s, Timestamp t, numeric p)
          : Tick(s, t, p, 0)
       {}
    };
@@ -0,0 +1,119 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// std headers
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// libraries headers
+#include "Poco/BinaryReader.h"
+#include "Poco/BinaryWriter.h"
+#include "Poco/Exception.h"
+
+// tradelib headers
+#include "tradelib/Order.h"
+#include "tradelib/Symbol.h"
+#include "tradelib/Types.h"
+
+namespace tradelib
+{
+   POCO_DECLARE_EXCEPTION(, TraceException, Poco::Exception)
+
+   /**
+    * @class Trace
+    *
+    * @brief A ring buffer of fixed-size binary records of the order lifecycle
+    *
+    * A FillSimulator with a trace attached (FillSimulator::setTrace) records every submit,
+    * trigger, fill, cancel, expire and position change. Recording is a store into the
+    * buffer - nothing is formatted - and a simulator without a trace only tests a null
+    * pointer. When the buffer is full the oldest records are overwritten, "dropped" counts
+    * them.
+    *
+    * A trace is not synchronized, it belongs to the thread running its simulator (a sweep
+    * gives each run its own, see Sweep::setTraceCapacity). It is saved in binary and decoded
+    * offline:
+    *
+    *    Trace trace(1 << 20);
+    *    replay.simulator().setTrace(&trace);
+    *    replay.start();
+    *    trace.save("replay.trace");
+    *    ...
+    *    Trace::dump("replay.trace", std::cout);
+    */
+   class Trace
+   {
+   public:
+      enum class Event : uint8
+      {
+         SUBMIT,
+         // A stop limit was stopped, its limit is active
+         TRIGGER,
+         FILL,
+         CANCEL,
+         EXPIRE,
+         // The position after a fill, in "quantity"
+         POSITION
+      };
+
+      class Record
+      {
+      public:
+         // Microseconds since the epoch (of the tick, the bar for expirations)
+         sint64 timestamp;
+         OrderHandle order;
+         numeric price;
+         sint32 quantity;
+         uint32 symbol;
+         Event event;
+      };
+
+      // The capacity is rounded up to a power of 2
+      explicit Trace(uint32 capacity);
+
+      void record(Event event, const Symbol & symbol, Timestamp timestamp, OrderHandle order, numeric price, long quantity)
+      {
+         Record & r = records_[static_cast<uint32>(next_) & mask_];
+         r.timestamp = timestamp.epochMicroseconds();
+         r.order = order;
+         r.price = price;
+         r.quantity = static_cast<sint32>(quantity);
+         r.symbol = symbol.id();
+         r.event = event;
+         ++next_;
+      }
+
+      uint32 capacity() const { return mask_ + 1; }
+      // The records held, at most the capacity
+      uint32 size() const { return next_ > mask_ ? mask_ + 1 : static_cast<uint32>(next_); }
+      // The records overwritten
+      uint64 dropped() const { return next_ - size(); }
+
+      // The ii-th record held, the oldest first
+      const Record & operator[](uint32 ii) const { return records_[static_cast<uint32>(next_ - size() + ii) & mask_]; }
+
+      void clear() { next_ = 0; }
+
+      // The records, oldest first, and the names of their symbols
+      void save(Poco::BinaryWriter & writer) const;
+      void save(const std::string & path) const;
+
+      // Writes a saved trace as text, one record per line
+      static void dump(std::istream & is, std::ostream & os);
+      static void dump(const std::string & path, std::ostream & os);
+
+      static const char * eventName(Event event);
+
+   protected:
+      static const uint32 MAGIC = 0x52544c54; // "TLTR" in little endian
+      static const uint32 VERSION = 1;
+
+      std::vector<Record> records_;
+      uint32 mask_;
+      // The number of records ever recorded
+      uint64 next_;
+   };
+}
+
+#endif // TRACE_H
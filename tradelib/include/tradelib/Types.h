@@ -8,6 +8,7 @@
 #include <deque>
 #include <limits>
 #include <stack>
+#include <utility>
 #include <vector>
 
 // libraries headers
@@ -16,6 +17,9 @@
 #include "Poco/Timespan.h"
 #include "Poco/Timestamp.h"
 
+// tradelib headers
+#include "tradelib/Event.h"
+
 // convenience types
 typedef int_fast32_t    sint;
 typedef uint_fast32_t   uint;
@@ -160,22 +164,29 @@ namespace tradelib
     * It also provides a subscription mechanism - observers are informed when a new value
     * is appended (push_back only supported).
     *
+    * The memory can be bounded with a window: at least the last "window" values are kept,
+    * older ones are dropped. The vector grows to twice the window and then drops the oldest
+    * half at once, so appending remains amortized O(1), while the values stay contiguous and
+    * in order - iterators and "data" work as before, between the drops. "[]" reaches back
+    * "window" values at least, "dropped" counts the values gone.
     */
    template<class T, class A = std::allocator<T>>
    class RVector : public std::vector<T, A>
    {
    public:
       // The observers are not meant to modify the value, that's why it's "const"
-      Poco::BasicEvent<const T> valueEvent;
+      Event<const T> valueEvent;
 
       void push_back(value_type && val)
       {
+         makeRoom();
          vector_type::push_back(std::move(val));
-         valueEvent(this, val);
+         valueEvent(this, *(end() - 1));
       }
 
       void push_back(const value_type & val)
       {
+         makeRoom();
          vector_type::push_back(val);
          valueEvent(this, val);
       }
@@ -183,10 +194,27 @@ namespace tradelib
       template<class... V>
       void emplace_back(V&&... val)
       {
+         makeRoom();
          vector_type::emplace_back(std::forward<V>(val)...);
          valueEvent(this, *(end() - 1));
       }
 
+      // 0 - keep all values (the default)
+      void setWindow(size_type window)
+      {
+         window_ = window;
+         if (window_ > 0 && size() > window_) drop(size() - window_);
+      }
+
+      size_type window() const { return window_; }
+
+      // The values dropped so far, "size() + dropped()" values were appended in total
+      uint64 dropped() const { return dropped_; }
+      // See Checkpoint
+      void setDropped(uint64 dropped) { dropped_ = dropped; }
+      // The oldest values the next append drops, 0 most of the time
+      size_type pendingDrop() const { return window_ > 0 && size() >= 2*window_ ? size() - window_ : 0; }
+
       const_reference operator[](size_type pos) const
       {
          return vector_type::operator[](vector_position(pos));
@@ -212,11 +240,91 @@ namespace tradelib
 
    protected:
       typedef std::vector<T, A> vector_type;
+
+      size_type window_ = 0;
+      uint64 dropped_ = 0;
+
+      void makeRoom()
+      {
+         size_type count = pendingDrop();
+         if (count > 0) drop(count);
+      }
+
+      void drop(size_type count)
+      {
+         vector_type::erase(begin(), begin() + count);
+         dropped_ += count;
+      }
    };
  
    typedef RVector<numeric> NumericRVector;
    typedef RVector<Timestamp> TimestampRVector;
    typedef RVector<long> LongRVector;
+
+   /**
+    * @class RingBuffer
+    *
+    * @brief A fixed capacity FIFO queue, N must be a power of two
+    *
+    * The elements live in an inline array and are never destroyed, popping only moves the
+    * head. Thus a popped element remains valid (and unchanged) until the slot is reused by
+    * a later push.
+    */
+   template<typename T, sint N>
+   class RingBuffer
+   {
+   public:
+      static const sint CAPACITY = N;
+      poco_static_assert(N > 0 && (N & (N - 1)) == 0);
+
+      RingBuffer()
+         : head_(0), size_(0)
+      {}
+
+      sint size() const { return size_; }
+      bool empty() const { return size_ == 0; }
+      bool full() const { return size_ == N; }
+
+      T & front() { return slots_[head_]; }
+      const T & front() const { return slots_[head_]; }
+
+      // The ii-th element from the front
+      T & operator[](sint ii) { return slots_[(head_ + ii) & (N - 1)]; }
+      const T & operator[](sint ii) const { return slots_[(head_ + ii) & (N - 1)]; }
+
+      void push(const T & value)
+      {
+         poco_assert_dbg(!full());
+         slots_[(head_ + size_) & (N - 1)] = value;
+         ++size_;
+      }
+
+      template<class... V>
+      void emplace(V&&... args)
+      {
+         poco_assert_dbg(!full());
+         slots_[(head_ + size_) & (N - 1)] = T(std::forward<V>(args)...);
+         ++size_;
+      }
+
+      void pop()
+      {
+         poco_assert_dbg(!empty());
+         head_ = (head_ + 1) & (N - 1);
+         --size_;
+      }
+
+      void clear()
+      {
+         head_ = 0;
+         size_ = 0;
+      }
+
+   private:
+      T slots_[N];
+      sint head_;
+      sint size_;
+   };
 }
 
 namespace tl = tradelib;
@@ -0,0 +1,246 @@
+#ifndef WALK_FORWARD_H
+#define WALK_FORWARD_H
+
+// std headers
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <vector>
+
+// tradelib headers
+#include "tradelib/MarketData.h"
+#include "tradelib/Parallel.h"
+#include "tradelib/Portfolio.h"
+#include "tradelib/Replay.h"
+
+namespace tradelib
+{
+   /**
+    * @class WalkForward
+    *
+    * @brief Walk-forward optimization of a strategy over a set of parameters
+    *
+    * The data is split in rolling windows: an in-sample period followed by an out-of-sample
+    * period, the next window starting one out-of-sample period later. In each window the
+    * parameters with the best in-sample metric (i.e. &TradeSummary::sharpeRatio, averaged over
+    * the symbols that traded) are selected, and their out-of-sample PnL is stitched with the
+    * other windows' into a single out-of-sample equity curve.
+    *
+    * Each parameter set is replayed once, from the beginning of the data to its end, and the
+    * windows are cut out of that run - the indicators are warmed up once for all the windows,
+    * instead of once per window. The positions carry over the window boundaries, the same as
+    * in a continuous run. The replays run in parallel, then so do the window evaluations.
+    *
+    * The strategy is constructed with (Broker *, const P &), as for Sweep.
+    */
+   template<class S, class P>
+   class WalkForward
+   {
+   public:
+      typedef numeric TradeSummary::* Metric;
+
+      class Window
+      {
+      public:
+         Timestamp inSampleStart;
+         Timestamp outOfSampleStart;
+         Timestamp outOfSampleEnd;
+         // The index of the best parameters, -1 if none of them traded in-sample
+         sint best;
+         numeric inSampleScore;
+         // The daily out-of-sample PnL of the best parameters, over all symbols
+         NumericIndexer outOfSamplePnl;
+      };
+
+      typedef std::vector<Window> WindowVector;
+
+      // 0 threads - one per processor
+      WalkForward(std::shared_ptr<const MarketData> data, Timespan inSample, Timespan outOfSample, sint threads = 0)
+         : data_(data), inSample_(inSample), outOfSample_(outOfSample), threads_(threads)
+      {
+         poco_assert(inSample_.totalMicroseconds() > 0 && outOfSample_.totalMicroseconds() > 0);
+      }
+
+      void add(const P & parameters) { parameters_.push_back(parameters); }
+
+      const std::vector<P> & parameters() const { return parameters_; }
+
+      // "equity" is the cumulative out-of-sample PnL, across the windows
+      void run(Metric metric, WindowVector & windows, NumericIndexer & equity);
+
+   protected:
+      // The outcome of replaying one parameter set, per symbol (in the order of the MarketData)
+      class RunData
+      {
+      public:
+         std::vector<NumericIndexer> pnl;
+         std::vector<TradeStatsVector> trades;
+      };
+
+      class ReplayJob
+      {
+      public:
+         explicit ReplayJob(WalkForward & walkForward)
+            : walkForward_(walkForward)
+         {}
+
+         void operator()(sint run) { walkForward_.replay(run); }
+
+      protected:
+         WalkForward & walkForward_;
+      };
+
+      class WindowJob
+      {
+      public:
+         WindowJob(WalkForward & walkForward, Metric metric, WindowVector & windows)
+            : walkForward_(walkForward), metric_(metric), windows_(windows)
+         {}
+
+         void operator()(sint window) { walkForward_.evaluate(metric_, windows_[window]); }
+
+      protected:
+         WalkForward & walkForward_;
+         Metric metric_;
+         WindowVector & windows_;
+      };
+
+      void replay(sint run);
+      void evaluate(Metric metric, Window & window);
+
+      // The part of "series" within [start, end)
+      static void slice(const NumericIndexer & series, Timestamp start, Timestamp end, NumericIndexer & result)
+      {
+         auto first = std::lower_bound(series.index.begin(), series.index.end(), start);
+         auto last = std::lower_bound(first, series.index.end(), end);
+         result.resize(0);
+         result.append(first, last, series.container.begin() + (first - series.index.begin()), series.container.begin() + (last - series.index.begin()));
+      }
+
+      std::shared_ptr<const MarketData> data_;
+      Timespan inSample_;
+      Timespan outOfSample_;
+      sint threads_;
+      std::vector<P> parameters_;
+
+      // Indexed by the run
+      std::vector<RunData> runs_;
+   };
+
+   template<class S, class P>
+   void WalkForward<S, P>::run(Metric metric, WindowVector & windows, NumericIndexer & equity)
+   {
+      windows.clear();
+      equity.resize(0);
+
+      const std::vector<Bar> & bars = data_->bars();
+      if (bars.empty() || parameters_.empty()) return;
+
+      // The first window starts with the data, the last one is cut short by the end of it
+      Timestamp end = bars.back().timestamp + 1;
+      for (Timestamp start = bars.front().timestamp; start + inSample_ < end; start += outOfSample_)
+      {
+         Window window;
+         window.inSampleStart = start;
+         window.outOfSampleStart = start + inSample_;
+         window.outOfSampleEnd = std::min(window.outOfSampleStart + outOfSample_, end);
+         window.best = -1;
+         window.inSampleScore = NUMERIC_NAN;
+         windows.push_back(window);
+      }
+
+      runs_.assign(parameters_.size(), RunData());
+      ReplayJob replayJob(*this);
+      parallelFor(parameters_.size(), threads_, replayJob);
+
+      WindowJob windowJob(*this, metric, windows);
+      parallelFor(windows.size(), threads_, windowJob);
+
+      runs_.clear();
+
+      // Stitch the out-of-sample periods - they follow each other without overlapping
+      numeric total = 0.0;
+      for (auto & ww : windows)
+      {
+         for (sint ii = 0; ii < ww.outOfSamplePnl.size(); ++ii)
+         {
+            total += ww.outOfSamplePnl.container[ii];
+            equity.push_back(ww.outOfSamplePnl.index[ii], total);
+         }
+      }
+   }
+
+   template<class S, class P>
+   void WalkForward<S, P>::replay(sint run)
+   {
+      MarketDataFeed feed(data_);
+      Replay<MarketDataFeed, S> replay(feed, parameters_[run]);
+      for (auto & ss : data_->symbols()) replay.subscribe(ss);
+      replay.start();
+
+      const Portfolio * portfolio = replay.getPortfolio("default");
+      RunData & runData = runs_[run];
+      runData.pnl.resize(data_->instruments().size());
+      runData.trades.resize(data_->instruments().size());
+      for (sint ii = 0; ii < data_->instruments().size(); ++ii)
+      {
+         const Instrument & instrument = data_->instruments()[ii];
+         portfolio->getPnl(instrument, data_->closes(instrument.symbol()), runData.pnl[ii]);
+         portfolio->getTradeStats(instrument, runData.trades[ii]);
+      }
+   }
+
+   template<class S, class P>
+   void WalkForward<S, P>::evaluate(Metric metric, Window & window)
+   {
+      // Pick the parameters with the best in-sample score
+      NumericIndexer pnl;
+      TradeStatsVector trades;
+      for (sint run = 0; run < runs_.size(); ++run)
+      {
+         numeric score = 0.0;
+         sint scored = 0;
+         for (sint ii = 0; ii < runs_[run].trades.size(); ++ii)
+         {
+            // The trades closed in-sample
+            trades.clear();
+            for (auto & ts : runs_[run].trades[ii])
+            {
+               if (ts.end >= window.inSampleStart && ts.end < window.outOfSampleStart) trades.push_back(ts);
+            }
+            if (trades.empty()) continue;
+
+            TradeSummary all = TradeSummary(), longs = TradeSummary(), shorts = TradeSummary();
+            slice(runs_[run].pnl[ii], window.inSampleStart, window.outOfSampleStart, pnl);
+            Portfolio::summarizeTrades(trades, pnl, all, longs, shorts);
+
+            numeric value = all.*metric;
+            if (std::isnan(value)) continue;
+            score += value;
+            ++scored;
+         }
+
+         if (scored == 0) continue;
+         score /= scored;
+         // Ties go to the parameters added first
+         if (window.best < 0 || score > window.inSampleScore)
+         {
+            window.best = run;
+            window.inSampleScore = score;
+         }
+      }
+
+      // The out-of-sample PnL of the selected parameters, summed over the symbols
+      if (window.best < 0) return;
+      std::map<Timestamp, numeric> daily;
+      for (auto & symbolPnl : runs_[window.best].pnl)
+      {
+         slice(symbolPnl, window.outOfSampleStart, window.outOfSampleEnd, pnl);
+         for (sint ii = 0; ii < pnl.size(); ++ii) daily[pnl.index[ii]] += pnl.container[ii];
+      }
+      for (auto & dd : daily) window.outOfSamplePnl.push_back(dd.first, dd.second);
+   }
+}
+
+#endif // WALK_FORWARD_H
@@ -0,0 +1,218 @@
+// std headers
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// libraries headers
+#include "Poco/Checksum.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+
+// tradelib headers
+#include "tradelib/BarCache.h"
+#include "tradelib/BarFileReader.h"
+#include "tradelib/BinaryFile.h"
+
+namespace tradelib
+{
+   const std::string BarCache::SUFFIX(".barcache");
+
+   namespace
+   {
+      template<typename T>
+      void updateChecksum(Poco::Checksum & checksum, const T * column, uint64 rows)
+      {
+         // Poco::Checksum takes the length as an unsigned int
+         const char * data = reinterpret_cast<const char *>(column);
+         uint64 size = rows*sizeof(T);
+         while (size > 0)
+         {
+            unsigned int chunk = static_cast<unsigned int>(std::min<uint64>(size, 1 << 30));
+            checksum.update(data, chunk);
+            data += chunk;
+            size -= chunk;
+         }
+      }
+
+      template<typename T>
+      void writeColumn(std::ostream & os, const std::vector<T> & column)
+      {
+         if (!column.empty()) os.write(reinterpret_cast<const char *>(column.data()), column.size()*sizeof(T));
+      }
+   }
+
+   void BarCache::convert(const std::string & symbol, const std::string & csvPath, const std::string & format)
+   {
+      if (symbol.size() > BarCacheHeader::MAX_SYMBOL_LENGTH) throw BarCacheException("Symbol too long to cache: " + symbol);
+
+      // Identify the source before reading it, a concurrent update makes the cache stale, not wrong
+      Poco::File csvFile(csvPath);
+      BarCacheHeader header;
+      std::memset(&header, 0, sizeof(header));
+      header.magic = BarCacheHeader::MAGIC;
+      header.version = BarCacheHeader::VERSION;
+      std::memcpy(header.symbol, symbol.data(), symbol.size());
+      header.sourceSize = static_cast<sint64>(csvFile.getSize());
+      header.sourceModified = csvFile.getLastModified().epochMicroseconds();
+      header.formatChecksum = formatChecksum(format);
+
+      std::vector<sint64> timestamp;
+      std::vector<numeric> open, high, low, close;
+      std::vector<uint64> volume, interest;
+
+      BarFileReader reader(symbol, csvPath, format);
+      Bar bar;
+      while (reader.next(bar))
+      {
+         timestamp.push_back(bar.timestamp.epochMicroseconds());
+         open.push_back(bar.open);
+         high.push_back(bar.high);
+         low.push_back(bar.low);
+         close.push_back(bar.close);
+         volume.push_back(bar.volume);
+         interest.push_back(bar.interest);
+      }
+
+      header.rows = timestamp.size();
+
+      Poco::Checksum checksum(Poco::Checksum::TYPE_CRC32);
+      updateChecksum(checksum, timestamp.data(), header.rows);
+      updateChecksum(checksum, open.data(), header.rows);
+      updateChecksum(checksum, high.data(), header.rows);
+      updateChecksum(checksum, low.data(), header.rows);
+      updateChecksum(checksum, close.data(), header.rows);
+      updateChecksum(checksum, volume.data(), header.rows);
+      updateChecksum(checksum, interest.data(), header.rows);
+      header.checksum = checksum.checksum();
+
+      // Readers never see a partial cache
+      BinaryFile::write<BarCacheException>(cachePath(csvPath), [&](std::ostream & os)
+      {
+         os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+         writeColumn(os, timestamp);
+         writeColumn(os, open);
+         writeColumn(os, high);
+         writeColumn(os, low);
+         writeColumn(os, close);
+         writeColumn(os, volume);
+         writeColumn(os, interest);
+      });
+   }
+
+   bool BarCache::isFresh(const std::string & csvPath, const std::string & format)
+   {
+      Poco::File csvFile(csvPath);
+      Poco::File cacheFile(cachePath(csvPath));
+      if (!csvFile.exists() || !cacheFile.exists() || cacheFile.getSize() < sizeof(BarCacheHeader)) return false;
+
+      BarCacheHeader header;
+      Poco::FileInputStream is(cacheFile.path(), std::ios::in | std::ios::binary);
+      is.read(reinterpret_cast<char *>(&header), sizeof(header));
+      if (!is.good()) return false;
+
+      return BinaryFile::matches(header.magic, header.version, BarCacheHeader::MAGIC, BarCacheHeader::VERSION) &&
+         header.sourceSize == static_cast<sint64>(csvFile.getSize()) &&
+         header.sourceModified == csvFile.getLastModified().epochMicroseconds() &&
+         header.formatChecksum == formatChecksum(format);
+   }
+
+   uint32 BarCache::formatChecksum(const std::string & format)
+   {
+      Poco::Checksum checksum(Poco::Checksum::TYPE_CRC32);
+      checksum.update(format);
+      return checksum.checksum();
+   }
+
+   BarCacheReader::BarCacheReader(const std::string & symbol, const std::string & cachePath)
+      : BarReader(symbol), rows_(0), row_(0)
+   {
+      Poco::File file(cachePath);
+      if (!file.exists() || file.getSize() < sizeof(BarCacheHeader)) throw BarCacheException("Not a bar cache: " + cachePath);
+
+      mapping_ = Poco::SharedMemory(file, Poco::SharedMemory::AM_READ);
+
+      const BarCacheHeader * header = reinterpret_cast<const BarCacheHeader *>(mapping_.begin());
+      BinaryFile::check<BarCacheException>(header->magic, header->version, BarCacheHeader::MAGIC, BarCacheHeader::VERSION, cachePath);
+      if (symbol.compare(0, std::string::npos, header->symbol, std::find(header->symbol, header->symbol + sizeof(header->symbol), '\0') - header->symbol) != 0)
+      {
+         throw BarCacheException("Bar cache " + cachePath + " is not for " + symbol);
+      }
+
+      uint64 rows = header->rows;
+      uint64 expectedSize = sizeof(BarCacheHeader) + rows*(sizeof(sint64) + 4*sizeof(numeric) + 2*sizeof(uint64));
+      if (static_cast<uint64>(mapping_.end() - mapping_.begin()) != expectedSize) throw BarCacheException("Truncated bar cache: " + cachePath);
+
+      const char * column = mapping_.begin() + sizeof(BarCacheHeader);
+      timestamp_ = reinterpret_cast<const sint64 *>(column);
+      open_ = reinterpret_cast<const numeric *>(timestamp_ + rows);
+      high_ = open_ + rows;
+      low_ = high_ + rows;
+      close_ = low_ + rows;
+      volume_ = reinterpret_cast<const uint64 *>(close_ + rows);
+      interest_ = volume_ + rows;
+
+      Poco::Checksum checksum(Poco::Checksum::TYPE_CRC32);
+      updateChecksum(checksum, timestamp_, rows);
+      updateChecksum(checksum, open_, rows);
+      updateChecksum(checksum, high_, rows);
+      updateChecksum(checksum, low_, rows);
+      updateChecksum(checksum, close_, rows);
+      updateChecksum(checksum, volume_, rows);
+      updateChecksum(checksum, interest_, rows);
+      if (checksum.checksum() != header->checksum) throw BarCacheException("Bad checksum: " + cachePath);
+
+      rows_ = rows;
+   }
+
+   void BarCacheReader::readBars()
+   {
+      while (row_ < rows_ && !buffer_.full())
+      {
+         buffer_.emplace(symbol_, Timestamp(timestamp_[row_]), open_[row_], high_[row_], low_[row_], close_[row_],
+                         static_cast<ulong>(volume_[row_]), static_cast<ulong>(interest_[row_]));
+         ++row_;
+      }
+   }
+
+   sint BarCacheReader::nextBatch(BarBlock & block, sint maxBars)
+   {
+      block.symbol = symbol_;
+
+      // Drain the buffered bars first, then copy straight from the columns
+      sint count = 0;
+      for (; count < maxBars && !buffer_.empty(); ++count)
+      {
+         block.append(buffer_.front());
+         buffer_.pop();
+      }
+
+      sint64 rows = std::min<sint64>(maxBars - count, rows_ - row_);
+      if (rows > 0)
+      {
+         for (sint64 ii = row_; ii < row_ + rows; ++ii) block.timestamp.push_back(Timestamp(timestamp_[ii]));
+         block.open.insert(block.open.end(), open_ + row_, open_ + row_ + rows);
+         block.high.insert(block.high.end(), high_ + row_, high_ + row_ + rows);
+         block.low.insert(block.low.end(), low_ + row_, low_ + row_ + rows);
+         block.close.insert(block.close.end(), close_ + row_, close_ + row_ + rows);
+         block.volume.insert(block.volume.end(), volume_ + row_, volume_ + row_ + rows);
+         block.interest.insert(block.interest.end(), interest_ + row_, interest_ + row_ + rows);
+         row_ += rows;
+         count += static_cast<sint>(rows);
+      }
+
+      if (count > 0) block.last = eof();
+      return count;
+   }
+
+   void BarCacheReader::setRange(Timestamp start, Timestamp end)
+   {
+      BarReader::setRange(start, end);
+
+      const sint64 * first = std::lower_bound(timestamp_ + row_, timestamp_ + rows_, start.epochMicroseconds());
+      const sint64 * last = std::lower_bound(first, timestamp_ + rows_, end.epochMicroseconds());
+      row_ = first - timestamp_;
+      rows_ = last - timestamp_;
+   }
+
+   POCO_IMPLEMENT_EXCEPTION(BarCacheException, Poco::Exception, "Bad bar cache")
+}
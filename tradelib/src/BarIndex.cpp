@@ -0,0 +1,105 @@
+// std headers
+#include <algorithm>
+#include <cstring>
+
+// libraries headers
+#include "Poco/DateTime.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+
+// tradelib headers
+#include "tradelib/BarCache.h"
+#include "tradelib/BarIndex.h"
+#include "tradelib/BinaryFile.h"
+#include "tradelib/CsvReader.h"
+#include "tradelib/DateParser.h"
+
+namespace tradelib
+{
+   const std::string BarIndex::SUFFIX(".idx");
+
+   void BarIndex::build(const std::string & csvPath, const std::string & format)
+   {
+      poco_assert(!CsvReader::isCompressed(csvPath));
+
+      Poco::File csvFile(csvPath);
+      BarIndexHeader header;
+      std::memset(&header, 0, sizeof(header));
+      header.magic = BarIndexHeader::MAGIC;
+      header.version = BarIndexHeader::VERSION;
+      header.sourceSize = static_cast<sint64>(csvFile.getSize());
+      header.sourceModified = csvFile.getLastModified().epochMicroseconds();
+      header.formatChecksum = BarCache::formatChecksum(format);
+
+      // Only the date column is parsed
+      std::vector<Entry> entries;
+      CsvReader reader(csvPath);
+      DateParser dateParser(format);
+      CsvFieldVector fields;
+      sint previousMonth = -1;
+      for (uint64 offset = reader.offset(); reader.next(fields); offset = reader.offset())
+      {
+         Timestamp timestamp = dateParser.parse(fields[0].begin(), fields[0].end());
+         Poco::DateTime dt(timestamp);
+         sint month = dt.year()*12 + dt.month() - 1;
+         if (month != previousMonth)
+         {
+            entries.push_back({ timestamp.epochMicroseconds(), offset });
+            previousMonth = month;
+         }
+      }
+
+      header.entries = entries.size();
+
+      // Readers never see a partial index
+      BinaryFile::write<BarIndexException>(indexPath(csvPath), [&](std::ostream & os)
+      {
+         os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+         if (!entries.empty()) os.write(reinterpret_cast<const char *>(entries.data()), entries.size()*sizeof(Entry));
+      });
+   }
+
+   bool BarIndex::isFresh(const std::string & csvPath, const std::string & format)
+   {
+      Poco::File csvFile(csvPath);
+      Poco::File indexFile(indexPath(csvPath));
+      if (!csvFile.exists() || !indexFile.exists() || indexFile.getSize() < sizeof(BarIndexHeader)) return false;
+
+      BarIndexHeader header;
+      Poco::FileInputStream is(indexFile.path(), std::ios::in | std::ios::binary);
+      is.read(reinterpret_cast<char *>(&header), sizeof(header));
+      if (!is.good()) return false;
+
+      return BinaryFile::matches(header.magic, header.version, BarIndexHeader::MAGIC, BarIndexHeader::VERSION) &&
+         header.sourceSize == static_cast<sint64>(csvFile.getSize()) &&
+         header.sourceModified == csvFile.getLastModified().epochMicroseconds() &&
+         header.formatChecksum == BarCache::formatChecksum(format);
+   }
+
+   BarIndex::BarIndex(const std::string & indexPath)
+   {
+      Poco::FileInputStream is(indexPath, std::ios::in | std::ios::binary);
+
+      BarIndexHeader header;
+      is.read(reinterpret_cast<char *>(&header), sizeof(header));
+      if (!is.good()) throw BarIndexException("Not a bar index: " + indexPath);
+      BinaryFile::check<BarIndexException>(header.magic, header.version, BarIndexHeader::MAGIC, BarIndexHeader::VERSION, indexPath);
+
+      entries_.resize(static_cast<size_t>(header.entries));
+      if (!entries_.empty())
+      {
+         is.read(reinterpret_cast<char *>(entries_.data()), entries_.size()*sizeof(Entry));
+         if (static_cast<uint64>(is.gcount()) != entries_.size()*sizeof(Entry)) throw BarIndexException("Truncated bar index: " + indexPath);
+      }
+   }
+
+   uint64 BarIndex::offset(Timestamp start) const
+   {
+      // The last month starting at or before "start" - its first row may still precede "start"
+      sint64 key = start.epochMicroseconds();
+      auto it = std::upper_bound(entries_.begin(), entries_.end(), key, [](sint64 kk, const Entry & ee) { return kk < ee.timestamp; });
+      return it == entries_.begin() ? 0 : (it - 1)->offset;
+   }
+
+   POCO_IMPLEMENT_EXCEPTION(BarIndexException, Poco::Exception, "Bad bar index")
+}
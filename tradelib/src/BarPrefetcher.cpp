@@ -0,0 +1,152 @@
+// std headers
+#include <algorithm>
+
+// tradelib headers
+#include "tradelib/BarPrefetcher.h"
+
+namespace tradelib
+{
+   class BarPrefetcher::Reader : public BarReader
+   {
+   public:
+      Reader(BarPrefetcher & prefetcher, Queue & queue)
+         : BarReader(queue.source.symbol()), prefetcher_(prefetcher), queue_(queue)
+      {}
+
+   protected:
+      virtual void readBars() { prefetcher_.take(queue_, buffer_, CACHE_SIZE); }
+      virtual bool exhausted() const { return prefetcher_.exhausted(queue_); }
+
+      BarPrefetcher & prefetcher_;
+      Queue & queue_;
+   };
+
+   BarPrefetcher::BarPrefetcher(sint threads, sint depth)
+      : depth_(depth), stopping_(false)
+   {
+      poco_assert(threads > 0 && depth > 0);
+      for (sint ii = 0; ii < threads; ++ii) threads_.emplace_back(new Poco::Thread());
+   }
+
+   BarPrefetcher::~BarPrefetcher()
+   {
+      stop();
+   }
+
+   std::unique_ptr<BarReader> BarPrefetcher::prefetch(BarReader & source)
+   {
+      queues_.emplace_back(source);
+      return std::unique_ptr<BarReader>(new Reader(*this, queues_.back()));
+   }
+
+   void BarPrefetcher::start()
+   {
+      {
+         Poco::FastMutex::ScopedLock lock(mutex_);
+         for (auto & qq : queues_) schedule(qq);
+      }
+
+      for (auto & tt : threads_) tt->start(*this);
+   }
+
+   void BarPrefetcher::stop()
+   {
+      {
+         Poco::FastMutex::ScopedLock lock(mutex_);
+         if (stopping_) return;
+         stopping_ = true;
+         workAvailable_.broadcast();
+      }
+
+      for (auto & tt : threads_) tt->join();
+   }
+
+   void BarPrefetcher::schedule(Queue & queue)
+   {
+      if (queue.scheduled || queue.done) return;
+
+      queue.scheduled = true;
+      work_.push_back(&queue);
+      workAvailable_.signal();
+   }
+
+   void BarPrefetcher::run()
+   {
+      std::vector<Bar> chunk;
+      chunk.reserve(CHUNK_SIZE);
+
+      while (true)
+      {
+         Queue * queue;
+         sint count;
+         {
+            Poco::FastMutex::ScopedLock lock(mutex_);
+            while (work_.empty() && !stopping_) workAvailable_.wait(mutex_);
+            if (stopping_) return;
+
+            queue = work_.front();
+            work_.pop_front();
+            count = std::min(CHUNK_SIZE, depth_ - static_cast<sint>(queue->bars.size()));
+         }
+
+         // Decode without the lock - the queue is scheduled, no other worker touches the source
+         std::exception_ptr error;
+         bool done = false;
+         chunk.clear();
+         try
+         {
+            Bar bar;
+            for (sint ii = 0; ii < count && queue->source.next(bar); ++ii) chunk.push_back(bar);
+            done = queue->source.eof();
+         }
+         catch (...)
+         {
+            error = std::current_exception();
+            done = true;
+         }
+
+         {
+            Poco::FastMutex::ScopedLock lock(mutex_);
+            for (auto & bb : chunk) queue->bars.push_back(std::move(bb));
+            queue->done = done;
+            queue->error = error;
+            queue->scheduled = false;
+
+            // Keep decoding until the queue is full, behind the other scheduled queues
+            if (static_cast<sint>(queue->bars.size()) < depth_) schedule(*queue);
+
+            barsAvailable_.broadcast();
+         }
+      }
+   }
+
+   void BarPrefetcher::take(Queue & queue, BarReader::BarRing & buffer, sint capacity)
+   {
+      Poco::FastMutex::ScopedLock lock(mutex_);
+
+      // BarReader needs two bars to tell whether the next one is the last one
+      while (true)
+      {
+         while (static_cast<sint>(buffer.size()) < capacity && !queue.bars.empty())
+         {
+            buffer.push(queue.bars.front());
+            queue.bars.pop_front();
+         }
+
+         if (queue.bars.empty() && queue.error) std::rethrow_exception(queue.error);
+         if (buffer.size() >= 2 || (queue.done && queue.bars.empty())) break;
+
+         schedule(queue);
+         barsAvailable_.wait(mutex_);
+      }
+
+      // Refill at half depth, so that a worker doesn't wake up for every chunk the replay takes
+      if (static_cast<sint>(queue.bars.size()) <= depth_/2) schedule(queue);
+   }
+
+   bool BarPrefetcher::exhausted(Queue & queue)
+   {
+      Poco::FastMutex::ScopedLock lock(mutex_);
+      return queue.done && queue.bars.empty();
+   }
+}
@@ -0,0 +1,65 @@
+// libraries headers
+#include "Poco/File.h"
+
+// tradelib headers
+#include "tradelib/BarSpill.h"
+#include "tradelib/BinaryFile.h"
+
+namespace tradelib
+{
+   BarSpill::BarSpill(const std::string & path)
+      : path_(path), os_(path, std::ios::out | std::ios::trunc | std::ios::binary), records_(0)
+   {
+      BarSpillHeader header;
+      header.magic = BarSpillHeader::MAGIC;
+      header.version = BarSpillHeader::VERSION;
+      os_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      if (!os_.good()) throw BarSpillException("Failed to write " + path_);
+   }
+
+   void BarSpill::write(const BarHistory & history, size_t count)
+   {
+      poco_assert(count <= history.timestamp.size());
+
+      for (size_t ii = 0; ii < count; ++ii)
+      {
+         BarSpillRecord record;
+         record.timestamp = history.timestamp.begin()[ii].epochMicroseconds();
+         record.open = history.open.begin()[ii];
+         record.high = history.high.begin()[ii];
+         record.low = history.low.begin()[ii];
+         record.close = history.close.begin()[ii];
+         record.volume = history.volume.begin()[ii];
+         record.interest = history.interest.begin()[ii];
+         os_.write(reinterpret_cast<const char *>(&record), sizeof(record));
+      }
+      if (!os_.good()) throw BarSpillException("Failed to write " + path_);
+      records_ += count;
+   }
+
+   void BarSpill::flush()
+   {
+      os_.flush();
+      if (!os_.good()) throw BarSpillException("Failed to write " + path_);
+   }
+
+   BarSpillReader::BarSpillReader(const std::string & path)
+      : records_(nullptr), size_(0)
+   {
+      Poco::File file(path);
+      if (!file.exists() || file.getSize() < sizeof(BarSpillHeader)) throw BarSpillException("Not a bar spill: " + path);
+
+      mapping_ = Poco::SharedMemory(file, Poco::SharedMemory::AM_READ);
+
+      const BarSpillHeader * header = reinterpret_cast<const BarSpillHeader *>(mapping_.begin());
+      BinaryFile::check<BarSpillException>(header->magic, header->version, BarSpillHeader::MAGIC, BarSpillHeader::VERSION, path);
+
+      uint64 size = static_cast<uint64>(mapping_.end() - mapping_.begin()) - sizeof(BarSpillHeader);
+      if (size % sizeof(BarSpillRecord) != 0) throw BarSpillException("Bar spill size mismatch: " + path);
+
+      records_ = reinterpret_cast<const BarSpillRecord *>(mapping_.begin() + sizeof(BarSpillHeader));
+      size_ = size / sizeof(BarSpillRecord);
+   }
+
+   POCO_IMPLEMENT_EXCEPTION(BarSpillException, Poco::Exception, "Bad bar spill")
+}
@@ -0,0 +1,153 @@
+// std headers
+#include <cstring>
+#include <vector>
+
+// libraries headers
+#include "Poco/File.h"
+
+// tradelib headers
+#include "tradelib/BarStore.h"
+#include "tradelib/BinaryFile.h"
+
+namespace tradelib
+{
+   namespace
+   {
+      template<typename T>
+      void writeColumn(std::ostream & os, const std::vector<T> & column)
+      {
+         if (!column.empty()) os.write(reinterpret_cast<const char *>(column.data()), column.size()*sizeof(T));
+      }
+   }
+
+   void BarStore::publish(const MarketData & data, const std::string & path)
+   {
+      const std::vector<Instrument> & instruments = data.instruments();
+
+      BarStoreHeader header;
+      std::memset(&header, 0, sizeof(header));
+      header.magic = BarStoreHeader::MAGIC;
+      header.version = BarStoreHeader::VERSION;
+      header.instruments = static_cast<uint32>(instruments.size());
+      header.rows = data.bars().size();
+
+      // The instrument records, and the record of each symbol id
+      std::vector<InstrumentRecord> records(instruments.size());
+      InstrumentRecordIndex recordOf;
+      for (uint32 ii = 0; ii < instruments.size(); ++ii)
+      {
+         const Instrument & instrument = instruments[ii];
+         if (!InstrumentRecord::fits(instrument.symbol().name())) throw BarStoreException("Symbol too long to store: " + instrument.symbol().name());
+
+         records[ii].set(instrument);
+         recordOf.add(instrument.symbol(), ii);
+      }
+
+      // All the variations, like the market data
+      std::vector<InstrumentVariationRecord> variations;
+      for (auto & provider : data.variations())
+      {
+         for (auto & variation : provider.second)
+         {
+            if (!InstrumentVariationRecord::fits(provider.first, variation.first, variation.second)) throw BarStoreException("Variation too long to store: " + provider.first + "/" + variation.first);
+
+            variations.push_back(InstrumentVariationRecord());
+            variations.back().set(provider.first, variation.first, variation.second);
+         }
+      }
+      header.variations = static_cast<uint32>(variations.size());
+
+      std::vector<sint64> timestamp;
+      std::vector<numeric> open, high, low, close;
+      std::vector<uint64> volume, interest;
+      std::vector<uint32> instrument;
+      timestamp.reserve(data.bars().size());
+      open.reserve(data.bars().size());
+      high.reserve(data.bars().size());
+      low.reserve(data.bars().size());
+      close.reserve(data.bars().size());
+      volume.reserve(data.bars().size());
+      interest.reserve(data.bars().size());
+      instrument.reserve(data.bars().size());
+      for (const Bar & bar : data.bars())
+      {
+         uint32 record = recordOf.find(bar.symbol);
+         if (record == InstrumentRecordIndex::NO_RECORD) throw BarStoreException("No instrument for the bars of " + bar.symbol.name());
+
+         timestamp.push_back(bar.timestamp.epochMicroseconds());
+         open.push_back(bar.open);
+         high.push_back(bar.high);
+         low.push_back(bar.low);
+         close.push_back(bar.close);
+         volume.push_back(bar.volume);
+         interest.push_back(bar.interest);
+         instrument.push_back(record);
+      }
+
+      BinaryFile::write<BarStoreException>(path, [&](std::ostream & os)
+      {
+         os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+         writeColumn(os, records);
+         writeColumn(os, variations);
+         writeColumn(os, timestamp);
+         writeColumn(os, open);
+         writeColumn(os, high);
+         writeColumn(os, low);
+         writeColumn(os, close);
+         writeColumn(os, volume);
+         writeColumn(os, interest);
+         writeColumn(os, instrument);
+      });
+   }
+
+   BarStoreFeed::BarStoreFeed(const std::string & path)
+      : rows_(0)
+   {
+      Poco::File file(path);
+      if (!file.exists() || file.getSize() < sizeof(BarStoreHeader)) throw BarStoreException("Not a bar store: " + path);
+
+      mapping_ = Poco::SharedMemory(file, Poco::SharedMemory::AM_READ);
+
+      const BarStoreHeader * header = reinterpret_cast<const BarStoreHeader *>(mapping_.begin());
+      BinaryFile::check<BarStoreException>(header->magic, header->version, BarStoreHeader::MAGIC, BarStoreHeader::VERSION, path);
+
+      uint64 rows = header->rows;
+      uint64 expectedSize = sizeof(BarStoreHeader) + header->instruments*sizeof(InstrumentRecord) + header->variations*sizeof(InstrumentVariationRecord) +
+         rows*(sizeof(sint64) + 4*sizeof(numeric) + 2*sizeof(uint64) + sizeof(uint32));
+      if (static_cast<uint64>(mapping_.end() - mapping_.begin()) != expectedSize) throw BarStoreException("Bar store size mismatch: " + path);
+
+      const InstrumentRecord * records = reinterpret_cast<const InstrumentRecord *>(mapping_.begin() + sizeof(BarStoreHeader));
+      for (uint32 ii = 0; ii < header->instruments; ++ii) addInstrument(records[ii]);
+
+      const InstrumentVariationRecord * variations = reinterpret_cast<const InstrumentVariationRecord *>(records + header->instruments);
+      for (uint32 ii = 0; ii < header->variations; ++ii) addVariation(variations[ii]);
+
+      const char * column = reinterpret_cast<const char *>(variations + header->variations);
+      timestamp_ = reinterpret_cast<const sint64 *>(column);
+      open_ = reinterpret_cast<const numeric *>(timestamp_ + rows);
+      high_ = open_ + rows;
+      low_ = high_ + rows;
+      close_ = low_ + rows;
+      volume_ = reinterpret_cast<const uint64 *>(close_ + rows);
+      interest_ = volume_ + rows;
+      instrument_ = reinterpret_cast<const uint32 *>(interest_ + rows);
+
+      for (uint64 ii = 0; ii < rows; ++ii)
+      {
+         if (instrument_[ii] >= symbols_.size()) throw BarStoreException("Bad instrument in bar store: " + path);
+      }
+
+      rows_ = rows;
+   }
+
+   void BarStoreFeed::start()
+   {
+      uint64 end = subscribedEnd();
+      for (uint64 ii = 0; ii < end; ++ii)
+      {
+         if (subscribed_[instrument_[ii]]) barEvent(bar(ii, ii == end - 1));
+      }
+   }
+
+   POCO_IMPLEMENT_EXCEPTION(BarStoreException, Poco::Exception, "Bad bar store")
+}
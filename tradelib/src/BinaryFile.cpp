@@ -0,0 +1,41 @@
+// libraries headers
+#include "Poco/ByteOrder.h"
+#include "Poco/Exception.h"
+#include "Poco/NumberFormatter.h"
+
+// tradelib headers
+#include "tradelib/BinaryFile.h"
+
+namespace tradelib
+{
+   namespace
+   {
+      std::string named(const std::string & message, const std::string & what)
+      {
+         return what.empty() ? message : message + ": " + what;
+      }
+   }
+
+   void BinaryFile::remove(const std::string & path)
+   {
+      try
+      {
+         Poco::File file(path);
+         if (file.exists()) file.remove();
+      }
+      catch (Poco::Exception &)
+      {
+      }
+   }
+
+   std::string BinaryFile::mismatch(uint32 magic, uint32 expectedMagic, const std::string & what)
+   {
+      if (magic == Poco::ByteOrder::flipBytes(expectedMagic)) return named("Written with the other byte order", what);
+      return named("Wrong magic", what);
+   }
+
+   std::string BinaryFile::unsupported(uint32 version, const std::string & what)
+   {
+      return named("Unsupported version " + Poco::NumberFormatter::format(version), what);
+   }
+}
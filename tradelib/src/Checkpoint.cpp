@@ -0,0 +1,67 @@
+// std headers
+#include <istream>
+#include <ostream>
+
+// libraries headers
+#include "Poco/BinaryReader.h"
+#include "Poco/BinaryWriter.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+
+// tradelib headers
+#include "tradelib/BinaryFile.h"
+#include "tradelib/Checkpoint.h"
+
+namespace tradelib
+{
+   void Checkpoint::save(std::ostream & os, const FillSimulator & simulator, const Strategy & strategy)
+   {
+      Poco::BinaryWriter writer(os);
+      writer << MAGIC << VERSION;
+      simulator.save(writer);
+      strategy.save(writer);
+      // The magic again - a truncated checkpoint doesn't end with it
+      writer << MAGIC;
+      writer.flush();
+      if (!os.good()) throw CheckpointException("Failed to write the checkpoint");
+   }
+
+   void Checkpoint::load(std::istream & is, FillSimulator & simulator, Strategy & strategy)
+   {
+      Poco::BinaryReader reader(is);
+      uint32 magic = 0;
+      uint32 version = 0;
+      reader >> magic >> version;
+      if (!reader.good()) throw CheckpointException("Not a checkpoint");
+      BinaryFile::check<CheckpointException>(magic, version, MAGIC, VERSION, "");
+
+      simulator.load(reader);
+      strategy.load(reader);
+
+      magic = 0;
+      reader >> magic;
+      if (!reader.good() || magic != MAGIC) throw CheckpointException("Truncated checkpoint");
+   }
+
+   void Checkpoint::save(const std::string & path, const FillSimulator & simulator, const Strategy & strategy)
+   {
+      BinaryFile::write<CheckpointException>(path, [&](std::ostream & os) { save(os, simulator, strategy); });
+   }
+
+   void Checkpoint::load(const std::string & path, FillSimulator & simulator, Strategy & strategy)
+   {
+      if (!Poco::File(path).exists()) throw CheckpointException("No checkpoint: " + path);
+
+      Poco::FileInputStream is(path, std::ios::in | std::ios::binary);
+      try
+      {
+         load(is, simulator, strategy);
+      }
+      catch (CheckpointException & e)
+      {
+         throw CheckpointException(e.message() + ": " + path);
+      }
+   }
+
+   POCO_IMPLEMENT_EXCEPTION(CheckpointException, Poco::Exception, "Bad checkpoint")
+}
@@ -1,38 +1,174 @@
 #include "Poco/Exception.h"
+#include "Poco/File.h"
 #include "Poco/NumberFormatter.h"
+#include "Poco/String.h"
 
 #include "tradelib/CsvReader.h"
 
 namespace tradelib
 {
-   bool CsvReader::next(std::vector<std::string> & columns)
+   namespace
+   {
+      bool hasSuffix(const std::string & path, const std::string & suffix)
+      {
+         return path.size() >= suffix.size() && Poco::icompare(path, path.size() - suffix.size(), suffix.size(), suffix) == 0;
+      }
+   }
+
+   CsvReader::CsvReader(const std::string & path, const std::string & separators)
+      : stream_(nullptr), cursor_(nullptr), end_(nullptr), numColumns_(-1), separators_(separators), numLines_(0)
+   {
+      if (hasSuffix(path, ".zst"))
+      {
+         // Poco doesn't come with zstd
+         throw Poco::NotImplementedException("zstd compressed files are not supported: " + path);
+      }
+
+      // Mapping an empty file fails, both are treated as an empty CSV
+      Poco::File file(path);
+      if (!file.exists() || file.getSize() == 0) return;
+
+      if (isCompressed(path))
+      {
+         file_.reset(new Poco::FileInputStream(path, std::ios::in | std::ios::binary));
+         inflater_.reset(new Poco::InflatingInputStream(*file_, Poco::InflatingStreamBuf::STREAM_GZIP));
+         buffer_.resize(BLOCK_SIZE);
+      }
+      else
+      {
+         mapping_ = Poco::SharedMemory(file, Poco::SharedMemory::AM_READ);
+         cursor_ = mapping_.begin();
+         end_ = mapping_.end();
+      }
+   }
+
+   void CsvReader::seek(size_t offset)
+   {
+      poco_assert(stream_ == nullptr && !inflater_);
+      if (cursor_ == nullptr) return;
+
+      poco_assert(offset <= static_cast<size_t>(mapping_.end() - mapping_.begin()));
+      cursor_ = mapping_.begin() + offset;
+   }
+
+   bool CsvReader::isCompressed(const std::string & path)
+   {
+      return hasSuffix(path, ".gz");
+   }
+
+   bool CsvReader::fill()
+   {
+      if (!inflater_->good()) return false;
+
+      // Move the unscanned tail (a partial line) to the front, make room for a block after it
+      size_t tail = end_ - cursor_;
+      if (tail > 0) std::memmove(buffer_.data(), cursor_, tail);
+      if (buffer_.size() < tail + BLOCK_SIZE) buffer_.resize(tail + BLOCK_SIZE);
+
+      inflater_->read(buffer_.data() + tail, BLOCK_SIZE);
+      size_t count = static_cast<size_t>(inflater_->gcount());
+      if (inflater_->bad()) throw CsvException("Failed to decompress the CSV");
+
+      cursor_ = buffer_.data();
+      end_ = cursor_ + tail + count;
+      return count > 0;
+   }
+
+   bool CsvReader::nextLine(const char * & begin, const char * & end)
+   {
+      if (stream_ != nullptr)
+      {
+         if (!std::getline(*stream_, line_)) return false;
+         begin = line_.data();
+         end = begin + line_.size();
+      }
+      else
+      {
+         const char * eol = cursor_ != end_ ? static_cast<const char *>(std::memchr(cursor_, '\n', end_ - cursor_)) : nullptr;
+         if (inflater_)
+         {
+            // Compressed mode: buffer a whole line, or whatever is left of the input
+            while (eol == nullptr && fill()) eol = static_cast<const char *>(std::memchr(cursor_, '\n', end_ - cursor_));
+         }
+
+         if (cursor_ == end_) return false;
+         begin = cursor_;
+         if (eol == nullptr)
+         {
+            // The last line doesn't have a line break
+            end = cursor_ = end_;
+         }
+         else
+         {
+            end = eol;
+            cursor_ = eol + 1;
+         }
+      }
+
+      ++numLines_;
+      return true;
+   }
+
+   void CsvReader::split(const char * begin, const char * end, CsvFieldVector & fields) const
    {
-      std::string line;
-      if (!std::getline(*stream_, line)) return false;
+      fields.resize(0);
 
-      Poco::StringTokenizer tokenizer(line, separators_, Poco::StringTokenizer::TOK_TRIM);
-      Poco::StringTokenizer::Iterator it = tokenizer.begin();
+      // Same as Poco::StringTokenizer with TOK_TRIM: an empty line has no fields,
+      // otherwise there is always one more field than there are separators.
+      if (begin == end) return;
+
+      const char * fieldBegin = begin;
+      for (const char * it = begin; ; ++it)
+      {
+         if (it == end || isSeparator(*it))
+         {
+            const char * fieldEnd = it;
+            while (fieldBegin < fieldEnd && isSpace(*fieldBegin)) ++fieldBegin;
+            while (fieldEnd > fieldBegin && isSpace(*(fieldEnd - 1))) --fieldEnd;
+            fields.emplace_back(fieldBegin, fieldEnd - fieldBegin);
+
+            if (it == end) break;
+            fieldBegin = it + 1;
+         }
+      }
+   }
+
+   bool CsvReader::next(CsvFieldVector & fields)
+   {
+      const char * begin;
+      const char * end;
+      if (!nextLine(begin, end)) return false;
+
+      split(begin, end, fields);
 
       if (numColumns_ != -1)
       {
-         if (numColumns_ != tokenizer.count())
+         if (numColumns_ != fields.size())
          {
-            throw CsvException("Line " + Poco::NumberFormatter::format(numLines_) + " has " + Poco::NumberFormatter::format(tokenizer.count()) + " columns, previous lines had " + Poco::NumberFormatter::format(numColumns_) + " columns");
+            throw CsvException("Line " + Poco::NumberFormatter::format(numLines_) + " has " + Poco::NumberFormatter::format(fields.size()) + " columns, previous lines had " + Poco::NumberFormatter::format(numColumns_) + " columns");
          }
       }
       else
       {
-         numColumns_ = static_cast<sint>(tokenizer.count());
+         numColumns_ = static_cast<sint>(fields.size());
       }
 
+      return true;
+   }
+
+   bool CsvReader::next(std::vector<std::string> & columns)
+   {
+      CsvFieldVector fields;
+      if (!next(fields)) return false;
+
       columns.resize(numColumns_);
       for (sint ii = 0; ii < numColumns_; ++ii)
       {
-         columns[ii] = *it++;
+         columns[ii].assign(fields[ii].data, fields[ii].size);
       }
 
       return true;
    }
 
    POCO_IMPLEMENT_EXCEPTION(CsvException, Poco::Exception, "Bad CSV Format")
-}
\ No newline at end of file
+}
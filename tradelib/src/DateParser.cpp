@@ -0,0 +1,120 @@
+// libraries headers
+#include "Poco/DateTimeParser.h"
+
+// tradelib headers
+#include "tradelib/DateParser.h"
+
+namespace tradelib
+{
+   namespace
+   {
+      // Accumulates the digits in [begin, begin + count). Non-digits are flagged in "bad".
+      inline sint digits(const char * begin, sint count, uint & bad)
+      {
+         sint result = 0;
+         for (sint ii = 0; ii < count; ++ii)
+         {
+            uint digit = static_cast<uint>(static_cast<unsigned char>(begin[ii])) - '0';
+            bad |= digit > 9;
+            result = result*10 + static_cast<sint>(digit);
+         }
+         return result;
+      }
+
+      inline bool isLeapYear(sint year)
+      {
+         return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+      }
+
+      inline sint daysInMonth(sint year, sint month)
+      {
+         static const sint DAYS[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+         return month == 2 && isLeapYear(year) ? 29 : DAYS[month - 1];
+      }
+   }
+
+   DateParser::DateParser(const std::string & format)
+      : format_(format), layout_(Layout::GENERIC), cachedMonth_(-1), cachedDays_(0)
+   {
+      if (format_ == "%Y%m%d") layout_ = Layout::YYYYMMDD;
+      else if (format_ == "%Y-%m-%d") layout_ = Layout::YYYY_MM_DD;
+      else if (format_ == "%Y-%m-%d %H:%M:%S") layout_ = Layout::YYYY_MM_DD_HH_MM_SS;
+   }
+
+   Timestamp DateParser::parse(const char * begin, const char * end)
+   {
+      Timestamp timestamp;
+      if (layout_ != Layout::GENERIC && tryParseFixed(begin, end, timestamp)) return timestamp;
+
+      int tzd;
+      std::string s(begin, end);
+      return format_.length() > 0 ? Poco::DateTimeParser::parse(format_, s, tzd).timestamp() : Poco::DateTimeParser::parse(s, tzd).timestamp();
+   }
+
+   bool DateParser::tryParseFixed(const char * begin, const char * end, Timestamp & timestamp)
+   {
+      uint bad = 0;
+      sint year, month, day;
+      sint hour = 0, minute = 0, second = 0;
+
+      switch (layout_)
+      {
+      case Layout::YYYYMMDD:
+         if (end - begin != 8) return false;
+         year = digits(begin, 4, bad);
+         month = digits(begin + 4, 2, bad);
+         day = digits(begin + 6, 2, bad);
+         break;
+
+      case Layout::YYYY_MM_DD:
+         if (end - begin != 10) return false;
+         bad |= (begin[4] != '-') | (begin[7] != '-');
+         year = digits(begin, 4, bad);
+         month = digits(begin + 5, 2, bad);
+         day = digits(begin + 8, 2, bad);
+         break;
+
+      case Layout::YYYY_MM_DD_HH_MM_SS:
+         if (end - begin != 19) return false;
+         bad |= (begin[4] != '-') | (begin[7] != '-') | (begin[10] != ' ') | (begin[13] != ':') | (begin[16] != ':');
+         year = digits(begin, 4, bad);
+         month = digits(begin + 5, 2, bad);
+         day = digits(begin + 8, 2, bad);
+         hour = digits(begin + 11, 2, bad);
+         minute = digits(begin + 14, 2, bad);
+         second = digits(begin + 17, 2, bad);
+         break;
+
+      default:
+         return false;
+      }
+
+      // Leave anything odd to Poco
+      if (bad != 0) return false;
+      if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) return false;
+      if (hour > 23 || minute > 59 || second > 59) return false;
+
+      sint64 days = monthToDays(year, month) + day - 1;
+      sint64 seconds = days*86400 + hour*3600 + minute*60 + second;
+      timestamp = Timestamp(seconds*Timestamp::resolution());
+      return true;
+   }
+
+   sint64 DateParser::monthToDays(sint year, sint month)
+   {
+      sint key = year*12 + month - 1;
+      if (key != cachedMonth_)
+      {
+         // Days from 1970-01-01 to the first of the month (the proleptic Gregorian calendar)
+         sint y = month <= 2 ? year - 1 : year;
+         sint era = (y >= 0 ? y : y - 399) / 400;
+         sint yoe = y - era*400;
+         sint doy = (153*(month + (month > 2 ? -3 : 9)) + 2)/5;
+         sint doe = yoe*365 + yoe/4 - yoe/100 + doy;
+
+         cachedMonth_ = key;
+         cachedDays_ = static_cast<sint64>(era)*146097 + doe - 719468;
+      }
+      return cachedDays_;
+   }
+}
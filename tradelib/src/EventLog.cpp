@@ -0,0 +1,191 @@
+// std headers
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+// libraries headers
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+
+// tradelib headers
+#include "tradelib/BinaryFile.h"
+#include "tradelib/EventLog.h"
+
+namespace tradelib
+{
+   namespace
+   {
+      // Appends the bars of the source feed to the log, keeping track of each symbol's range
+      class EventLogWriter
+      {
+      public:
+         EventLogWriter(std::ostream & os, std::vector<EventLogSymbol> & table, const InstrumentRecordIndex & recordOf)
+            : os_(os), table_(table), recordOf_(recordOf), records_(0)
+         {}
+
+         void barEventHandler(const Bar & bar)
+         {
+            uint32 index = recordOf_.find(bar.symbol);
+            // The source may have had other symbols subscribed, they are not logged
+            if (index == InstrumentRecordIndex::NO_RECORD) return;
+
+            EventLogSymbol & entry = table_[index];
+            if (entry.bars == 0) entry.first = records_;
+            entry.end = records_ + 1;
+            ++entry.bars;
+
+            EventLogRecord record;
+            record.timestamp = bar.timestamp.epochMicroseconds();
+            record.open = bar.open;
+            record.high = bar.high;
+            record.low = bar.low;
+            record.close = bar.close;
+            record.volume = bar.volume;
+            record.interest = bar.interest;
+            record.symbol = index;
+            record.reserved = 0;
+            os_.write(reinterpret_cast<const char *>(&record), sizeof(record));
+            ++records_;
+         }
+
+         uint64 records() const { return records_; }
+
+      private:
+         std::ostream & os_;
+         std::vector<EventLogSymbol> & table_;
+         const InstrumentRecordIndex & recordOf_;
+         uint64 records_;
+      };
+   }
+
+   void EventLog::write(DataFeed & source, const std::vector<std::string> & symbols, const std::string & path)
+   {
+      EventLogHeader header;
+      std::memset(&header, 0, sizeof(header));
+      header.magic = EventLogHeader::MAGIC;
+      header.version = EventLogHeader::VERSION;
+      header.symbols = static_cast<uint32>(symbols.size());
+
+      // The symbol records, and the record of each symbol id
+      std::vector<EventLogSymbol> table(symbols.size());
+      InstrumentRecordIndex recordOf;
+      for (uint32 ii = 0; ii < symbols.size(); ++ii)
+      {
+         const Instrument * instrument = source.getInstrument(symbols[ii]);
+         if (instrument == nullptr) throw Poco::NotFoundException("No instrument for " + symbols[ii]);
+         if (!InstrumentRecord::fits(symbols[ii])) throw EventLogException("Symbol too long to log: " + symbols[ii]);
+
+         EventLogSymbol & entry = table[ii];
+         std::memset(&entry, 0, sizeof(entry));
+         entry.instrument.set(*instrument);
+         recordOf.add(instrument->symbol(), ii);
+
+         source.subscribe(symbols[ii]);
+      }
+
+      // All the variations of the source
+      std::vector<InstrumentVariationRecord> variations;
+      for (auto & provider : source.instrumentVariations())
+      {
+         for (auto & variation : provider.second)
+         {
+            if (!InstrumentVariationRecord::fits(provider.first, variation.first, variation.second)) throw EventLogException("Variation too long to log: " + provider.first + "/" + variation.first);
+
+            variations.push_back(InstrumentVariationRecord());
+            variations.back().set(provider.first, variation.first, variation.second);
+         }
+      }
+      header.variations = static_cast<uint32>(variations.size());
+
+      BinaryFile::write<EventLogException>(path, [&](std::ostream & os)
+      {
+         // The header and the table are written again once the records are known
+         os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+         if (!table.empty()) os.write(reinterpret_cast<const char *>(table.data()), table.size()*sizeof(EventLogSymbol));
+         if (!variations.empty()) os.write(reinterpret_cast<const char *>(variations.data()), variations.size()*sizeof(InstrumentVariationRecord));
+
+         EventLogWriter writer(os, table, recordOf);
+         source.barEvent.connect<EventLogWriter, &EventLogWriter::barEventHandler>(&writer);
+         try
+         {
+            source.start();
+         }
+         catch (...)
+         {
+            source.barEvent.disconnect(&writer);
+            throw;
+         }
+         source.barEvent.disconnect(&writer);
+
+         header.records = writer.records();
+         os.seekp(0);
+         os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+         if (!table.empty()) os.write(reinterpret_cast<const char *>(table.data()), table.size()*sizeof(EventLogSymbol));
+      });
+   }
+
+   EventLogFeed::EventLogFeed(const std::string & path)
+      : path_(path), offset_(0), records_(0)
+   {
+      Poco::File file(path);
+      if (!file.exists()) throw EventLogException("No event log: " + path);
+
+      Poco::FileInputStream is(path, std::ios::in | std::ios::binary);
+      EventLogHeader header;
+      is.read(reinterpret_cast<char *>(&header), sizeof(header));
+      if (!is.good()) throw EventLogException("Not an event log: " + path);
+      BinaryFile::check<EventLogException>(header.magic, header.version, EventLogHeader::MAGIC, EventLogHeader::VERSION, path);
+
+      table_.resize(header.symbols);
+      if (!table_.empty()) is.read(reinterpret_cast<char *>(table_.data()), table_.size()*sizeof(EventLogSymbol));
+      std::vector<InstrumentVariationRecord> variations(header.variations);
+      if (!variations.empty()) is.read(reinterpret_cast<char *>(variations.data()), variations.size()*sizeof(InstrumentVariationRecord));
+      if (!is.good()) throw EventLogException("Truncated event log: " + path);
+
+      offset_ = sizeof(EventLogHeader) + table_.size()*sizeof(EventLogSymbol) + variations.size()*sizeof(InstrumentVariationRecord);
+      records_ = header.records;
+      if (static_cast<uint64>(file.getSize()) != offset_ + records_*sizeof(EventLogRecord)) throw EventLogException("Truncated event log: " + path);
+
+      for (auto & entry : table_) addInstrument(entry.instrument);
+      for (auto & variation : variations) addVariation(variation);
+   }
+
+   void EventLogFeed::start()
+   {
+      // The records between the first bar of the subscribed symbols and the last one
+      uint64 first = std::numeric_limits<uint64>::max();
+      uint64 end = 0;
+      for (sint ii = 0; ii < table_.size(); ++ii)
+      {
+         if (!subscribed_[ii] || table_[ii].bars == 0) continue;
+         first = std::min(first, table_[ii].first);
+         end = std::max(end, table_[ii].end);
+      }
+      if (first >= end) return;
+
+      Poco::FileInputStream is(path_, std::ios::in | std::ios::binary);
+      is.seekg(offset_ + first*sizeof(EventLogRecord));
+      block_.resize(BLOCK_RECORDS);
+
+      for (uint64 record = first; record < end; )
+      {
+         uint32 count = static_cast<uint32>(std::min<uint64>(BLOCK_RECORDS, end - record));
+         is.read(reinterpret_cast<char *>(block_.data()), count*sizeof(EventLogRecord));
+         if (!is.good()) throw EventLogException("Failed to read " + path_);
+
+         for (uint32 ii = 0; ii < count; ++ii)
+         {
+            const EventLogRecord & r = block_[ii];
+            if (r.symbol >= subscribed_.size()) throw EventLogException("Bad symbol in event log: " + path_);
+            if (!subscribed_[r.symbol]) continue;
+
+            Bar bar(symbols_[r.symbol], Timestamp(r.timestamp), r.open, r.high, r.low, r.close, static_cast<ulong>(r.volume), static_cast<ulong>(r.interest));
+            bar.setLast(record + ii == end - 1);
+            barEvent(bar);
+         }
+         record += count;
+      }
+   }
+
+   POCO_IMPLEMENT_EXCEPTION(EventLogException, Poco::Exception, "Bad event log")
+}
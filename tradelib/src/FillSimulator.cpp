@@ -0,0 +1,377 @@
+// std headers
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+// tradelib headers
+#include "tradelib/FillSimulator.h"
+#include "tradelib/Serialization.h"
+
+namespace tradelib
+{
+   FillSimulator::InstrumentCB & FillSimulator::lookupInstrumentCB(const Symbol & symbol)
+   {
+      if (symbol.id() >= instrumentCBs_.size()) instrumentCBs_.resize(symbol.id() + 1);
+
+      std::unique_ptr<InstrumentCB> & icb = instrumentCBs_[symbol.id()];
+      if (icb) return *icb;
+      // Add a control block if one doesn't exist. Adding an order without an existing subscription
+      // sounds like a misuse, but throwing an exception because of it seems like an overkill too.
+      poco_check_ptr(dataFeed_);
+      icb.reset(new InstrumentCB(dataFeed_->getInstrument(symbol)));
+      return *icb;
+   }
+
+   OrderHandle FillSimulator::submitOrder(const Order & order)
+   {
+      InstrumentCB & icb = lookupInstrumentCB(order.symbol);
+      OrderHandle handle = orders_.add(order);
+      icb.newOrders.push_back(OrderStore::slot(handle));
+      if (trace_ != nullptr) trace_->record(Trace::Event::SUBMIT, order.symbol, icb.lastBar, handle, std::isnan(order.stopPrice) ? order.limitPrice : order.stopPrice, order.quantity);
+      return handle;
+   }
+
+   void FillSimulator::submitOco(const Order & first, const Order & second, OrderHandle & firstHandle, OrderHandle & secondHandle)
+   {
+      firstHandle = submitOrder(first);
+      secondHandle = submitOrder(second);
+      orders_.find(firstHandle)->setSibling(secondHandle);
+      orders_.find(secondHandle)->setSibling(firstHandle);
+   }
+
+   void FillSimulator::submitBracket(
+            const Order & entry,
+            const Order & target,
+            const Order & stop,
+            OrderHandle & entryHandle,
+            OrderHandle & targetHandle,
+            OrderHandle & stopHandle)
+   {
+      // The exits are resolved with the entry, in the same order list
+      poco_assert(target.symbol == entry.symbol && stop.symbol == entry.symbol);
+
+      entryHandle = submitOrder(entry);
+      submitOco(target, stop, targetHandle, stopHandle);
+      orders_.find(targetHandle)->makePending();
+      orders_.find(stopHandle)->makePending();
+      orders_.find(entryHandle)->attach(targetHandle);
+   }
+
+   void FillSimulator::resolveGroups(InstrumentCB & icb, const Order & order, Timestamp timestamp)
+   {
+      // Cancel the rest of the one-cancels-other group
+      for (OrderHandle handle = order.sibling(); ; )
+      {
+         Order * sibling = orders_.find(handle);
+         if (sibling == nullptr || sibling == &order) break;
+         if (sibling->isActive() || sibling->isPending())
+         {
+            sibling->cancel();
+            if (trace_ != nullptr) trace_->record(Trace::Event::CANCEL, sibling->symbol, timestamp, handle, NAN, sibling->quantity);
+         }
+         handle = sibling->sibling();
+      }
+
+      // The attached orders become eligible at the next tick
+      if (order.child() != NO_ORDER)
+      {
+         Order * first = orders_.find(order.child());
+         for (Order * child = first; child != nullptr; )
+         {
+            if (child->isPending()) child->activate();
+            child = orders_.find(child->sibling());
+            if (child == first) break;
+         }
+         icb.triggersStale = true;
+      }
+   }
+
+   void FillSimulator::cancelChildren(const Order & order, Timestamp timestamp)
+   {
+      for (OrderHandle handle = order.child(); ; )
+      {
+         Order * child = orders_.find(handle);
+         if (child == nullptr) break;
+         if (child->isPending())
+         {
+            child->cancel();
+            if (trace_ != nullptr) trace_->record(Trace::Event::CANCEL, child->symbol, timestamp, handle, NAN, child->quantity);
+         }
+         handle = child->sibling();
+         if (handle == order.child()) break;
+      }
+   }
+
+   bool FillSimulator::cancelOrder(OrderHandle handle)
+   {
+      Order * order = orders_.find(handle);
+      if (order == nullptr || !(order->isActive() || order->isPending())) return false;
+      // Removed from the instrument's orders at the end of the bar
+      order->cancel();
+      if (trace_ != nullptr) trace_->record(Trace::Event::CANCEL, order->symbol, lookupInstrumentCB(order->symbol).lastBar, handle, NAN, order->quantity);
+      return true;
+   }
+
+   bool FillSimulator::modifyOrder(OrderHandle handle, numeric price)
+   {
+      Order * order = orders_.find(handle);
+      if (order == nullptr || !order->isActive()) return false;
+      order->setTriggerPrice(price);
+      lookupInstrumentCB(order->symbol).triggersStale = true;
+      return true;
+   }
+
+   void FillSimulator::TriggerIndex::build(const OrderSlotVector & orders, const OrderStore & store)
+   {
+      rising_.resize(0);
+      falling_.resize(0);
+      unconditional_.resize(0);
+
+      for (uint32 ii = 0; ii < orders.size(); ++ii)
+      {
+         const Order & order = store[orders[ii]];
+         if (!order.isActive()) continue;
+
+         numeric price;
+         switch (order.trigger(price))
+         {
+         case Order::Trigger::NONE:
+            unconditional_.push_back(ii);
+            break;
+
+         case Order::Trigger::RISING:
+            // A NaN price never triggers, the order can't fill in its current state
+            if (!std::isnan(price)) rising_.emplace_back(price, ii);
+            break;
+
+         case Order::Trigger::FALLING:
+            if (!std::isnan(price)) falling_.emplace_back(price, ii);
+            break;
+         }
+      }
+
+      std::sort(std::begin(rising_), std::end(rising_));
+      std::sort(std::begin(falling_), std::end(falling_));
+   }
+
+   void FillSimulator::TriggerIndex::collect(numeric price, OrderPositionVector & positions) const
+   {
+      positions.insert(std::end(positions), std::begin(unconditional_), std::end(unconditional_));
+
+      // Rising triggers at or below the price
+      auto risingEnd = std::upper_bound(std::begin(rising_), std::end(rising_), price, [](numeric p, const Entry & e) { return p < e.first; });
+      for (auto it = std::begin(rising_); it != risingEnd; ++it) positions.push_back(it->second);
+
+      // Falling triggers at or above the price
+      auto fallingBegin = std::lower_bound(std::begin(falling_), std::end(falling_), price, [](const Entry & e, numeric p) { return e.first < p; });
+      for (auto it = fallingBegin; it != std::end(falling_); ++it) positions.push_back(it->second);
+   }
+
+   void FillSimulator::addNewOrders(InstrumentCB & icb)
+   {
+      if (icb.newOrders.empty()) return;
+      icb.orders.insert(std::end(icb.orders), std::begin(icb.newOrders), std::end(icb.newOrders));
+      icb.newOrders.resize(0);
+      icb.triggersStale = true;
+   }
+
+   void FillSimulator::processOrders(InstrumentCB & icb, const Tick & tick, bool executeOnLimitOrStop)
+   {
+      if (icb.orders.empty()) return;
+      if (icb.triggersStale)
+      {
+         icb.triggers.build(icb.orders, orders_);
+         icb.triggersStale = false;
+      }
+
+      // Only the orders triggered by the tick price can fill. They are checked in the order of
+      // submission, same as a scan of all orders would, so the fill priority is unchanged.
+      triggered_.resize(0);
+      icb.triggers.collect(tick.price, triggered_);
+      std::sort(std::begin(triggered_), std::end(triggered_));
+      // The notifications point into the executions, which must not move while they are added.
+      // The executions only hold the bar's fills, so this doesn't copy the history.
+      icb.executions.reserve(icb.executions.size() + triggered_.size());
+
+      for (uint32 position : triggered_)
+      {
+         Order & order = orders_[icb.orders[position]];
+         bool wasStopped = order.isStopped();
+         numeric fillPrice;
+         long filledQuantity;
+         long transactionQuantity;
+         long newPosition;
+         long previousPosition = icb.instrumentPosition.position;
+         bool filled = order.tryFill(tick, previousPosition, executeOnLimitOrStop, fillPrice, filledQuantity, transactionQuantity, newPosition);
+         // A stop limit which was stopped is triggered by its limit price from now on
+         if (order.isStopped() != wasStopped)
+         {
+            icb.triggersStale = true;
+            if (trace_ != nullptr) trace_->record(Trace::Event::TRIGGER, order.symbol, tick.timestamp, orders_.handle(icb.orders[position]), tick.price, order.quantity);
+         }
+         if (filled)
+         {
+            if (filled)
+            {
+               // Update the position
+               icb.instrumentPosition = { newPosition, tick.timestamp };
+
+               // Some previous exit orders may need to be cancelled. For instance, if we
+               // just exited a long position, any previous exit orders are cancelled.
+               bool removeExits;
+               if ((previousPosition > 0 && newPosition <= 0) || (previousPosition < 0 && newPosition >= 0))
+               {
+                  removeExits = true;
+               }
+               else
+               {
+                  removeExits = false;
+               }
+
+               // cancel the orders
+               if (removeExits)
+               {
+                  for (uint32 ii = 0; ii < position; ++ii)
+                  {
+                     // Cancel active, exit orders
+                     Order & previous = orders_[icb.orders[ii]];
+                     if (previous.isExit() && previous.isActive())
+                     {
+                        previous.cancel();
+                        if (trace_ != nullptr) trace_->record(Trace::Event::CANCEL, previous.symbol, tick.timestamp, orders_.handle(icb.orders[ii]), NAN, previous.quantity);
+                     }
+                  }
+               }
+
+               // Mark the current order as filled
+               order.fill();
+               if (trace_ != nullptr)
+               {
+                  trace_->record(Trace::Event::FILL, order.symbol, tick.timestamp, orders_.handle(icb.orders[position]), fillPrice, transactionQuantity);
+                  trace_->record(Trace::Event::POSITION, order.symbol, tick.timestamp, NO_ORDER, fillPrice, newPosition);
+               }
+               // Resolve the groups the order belongs to, in the same pass
+               if (order.sibling() != NO_ORDER || order.child() != NO_ORDER) resolveGroups(icb, order, tick.timestamp);
+               // Add a transaction to the portfolio
+               portfolio_.appendTransaction(*icb.instrument, tick.timestamp, transactionQuantity, fillPrice, 0.0);
+               // Add an execution
+               icb.executions.emplace_back(tick.symbol, tick.timestamp, fillPrice, filledQuantity);
+               // Add a notification (posted after the order processing loop finishes)
+               icb.orderNotifications.emplace_back(&order, &icb.executions.back());
+            }
+         }
+      }
+   }
+
+   void FillSimulator::cleanupOrders(InstrumentCB & icb, const Bar & bar)
+   {
+      // While improving performance by removing inactive orders from the list,
+      // we lose the order history. The orders kept are compacted in a single pass.
+      uint32 kept = 0;
+      for (uint32 ii = 0; ii < icb.orders.size(); ++ii)
+      {
+         uint32 slot = icb.orders[ii];
+         Order & order = orders_[slot];
+
+         // First expire the order if necessary
+         bool wasActive = order.isActive();
+         order.updateState(bar);
+         if (trace_ != nullptr && wasActive && order.isCancelled()) trace_->record(Trace::Event::EXPIRE, order.symbol, bar.timestamp, orders_.handle(slot), NAN, order.quantity);
+
+         if (order.isActive() || order.isPending())
+         {
+            icb.orders[kept++] = slot;
+         }
+         else
+         {
+            // The orders attached to an entry which didn't fill go with it. They follow it
+            // in the list, so they are released in this same pass.
+            if (!order.isFilled() && order.child() != NO_ORDER) cancelChildren(order, bar.timestamp);
+            orders_.release(slot);
+         }
+      }
+
+      if (kept < icb.orders.size())
+      {
+         icb.orders.resize(kept);
+         icb.triggersStale = true;
+      }
+   }
+
+   const Broker::InstrumentPosition * FillSimulator::getInstrumentPosition(const Symbol & symbol) const
+   {
+      if (symbol.id() >= instrumentCBs_.size() || !instrumentCBs_[symbol.id()]) return nullptr;
+      return &instrumentCBs_[symbol.id()]->instrumentPosition;
+   }
+
+   void FillSimulator::save(Poco::BinaryWriter & writer) const
+   {
+      Poco::UInt32 count = 0;
+      for (auto & icb : instrumentCBs_) if (icb) ++count;
+
+      writer << count;
+      for (sint ii = 0; ii < instrumentCBs_.size(); ++ii)
+      {
+         const InstrumentCB * icb = instrumentCBs_[ii].get();
+         if (icb == nullptr) continue;
+
+         // The executions and the notifications don't outlive the bar, only the orders carry over
+         writer << SymbolTable::instance().name(static_cast<uint32>(ii));
+         writer << static_cast<Poco::Int64>(icb->instrumentPosition.position);
+         serialize(writer, icb->instrumentPosition.since);
+         serialize(writer, icb->lastBar);
+
+         // The orders keep their handles
+         writer << static_cast<Poco::UInt64>(icb->orders.size() + icb->newOrders.size());
+         for (uint32 slot : icb->orders)
+         {
+            writer << static_cast<Poco::UInt64>(orders_.handle(slot));
+            orders_[slot].save(writer);
+         }
+         for (uint32 slot : icb->newOrders)
+         {
+            writer << static_cast<Poco::UInt64>(orders_.handle(slot));
+            orders_[slot].save(writer);
+         }
+      }
+
+      portfolio_.save(writer);
+   }
+
+   void FillSimulator::load(Poco::BinaryReader & reader)
+   {
+      reset();
+
+      Poco::UInt32 count = 0;
+      reader >> count;
+      for (Poco::UInt32 ii = 0; ii < count && reader.good(); ++ii)
+      {
+         Symbol symbol;
+         deserialize(reader, symbol);
+         InstrumentCB & icb = lookupInstrumentCB(symbol);
+
+         Poco::Int64 position;
+         reader >> position;
+         icb.instrumentPosition.position = static_cast<long>(position);
+         deserialize(reader, icb.instrumentPosition.since);
+         deserialize(reader, icb.lastBar);
+         icb.resumeAfter = icb.lastBar;
+
+         Poco::UInt64 orders = 0;
+         reader >> orders;
+         for (Poco::UInt64 jj = 0; jj < orders && reader.good(); ++jj)
+         {
+            Poco::UInt64 handle = 0;
+            Order order;
+            reader >> handle;
+            order.load(reader);
+            if (!reader.good()) break;
+            orders_.restore(handle, order);
+            icb.orders.push_back(OrderStore::slot(handle));
+         }
+         icb.triggersStale = true;
+      }
+
+      portfolio_.load(reader);
+   }
+}
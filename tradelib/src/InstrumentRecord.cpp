@@ -0,0 +1,110 @@
+// std headers
+#include <algorithm>
+#include <cstring>
+
+// libraries headers
+#include "Poco/Exception.h"
+
+// tradelib headers
+#include "tradelib/InstrumentRecord.h"
+
+namespace tradelib
+{
+   namespace
+   {
+      std::string fixedString(const char * s, size_t size)
+      {
+         return std::string(s, std::find(s, s + size, '\0') - s);
+      }
+   }
+
+   const uint32 InstrumentRecordIndex::NO_RECORD;
+
+   void InstrumentRecord::set(const Instrument & instrument)
+   {
+      const std::string & symbolName = instrument.symbol().name();
+      poco_assert(fits(symbolName));
+
+      std::memset(this, 0, sizeof(*this));
+      std::memcpy(symbol, symbolName.data(), symbolName.size());
+      std::memcpy(name, instrument.name().data(), std::min<size_t>(instrument.name().size(), MAX_NAME_LENGTH));
+      tick = instrument.tick();
+      bpv = instrument.bpv();
+      future = instrument.isFuture() ? 1 : 0;
+   }
+
+   Instrument InstrumentRecord::instrument() const
+   {
+      std::string symbol = symbolName();
+      std::string instrumentName = fixedString(name, sizeof(name));
+      return future ? Instrument::newFuture(symbol, tick, bpv, instrumentName) : Instrument::newStock(symbol, instrumentName);
+   }
+
+   std::string InstrumentRecord::symbolName() const
+   {
+      return fixedString(symbol, sizeof(symbol));
+   }
+
+   void InstrumentVariationRecord::set(const std::string & provider, const std::string & symbol, const InstrumentVariation & variation)
+   {
+      poco_assert(fits(provider, symbol, variation));
+
+      std::memset(this, 0, sizeof(*this));
+      std::memcpy(this->provider, provider.data(), provider.size());
+      std::memcpy(this->symbol, symbol.data(), symbol.size());
+      std::memcpy(variationSymbol, variation.symbol.data(), variation.symbol.size());
+      factor = variation.factor;
+      tick = variation.tick;
+   }
+
+   std::string InstrumentVariationRecord::providerName() const
+   {
+      return fixedString(provider, sizeof(provider));
+   }
+
+   std::string InstrumentVariationRecord::symbolName() const
+   {
+      return fixedString(symbol, sizeof(symbol));
+   }
+
+   InstrumentVariation InstrumentVariationRecord::variation() const
+   {
+      return InstrumentVariation(fixedString(variationSymbol, sizeof(variationSymbol)), factor, tick);
+   }
+
+   void InstrumentRecordFeed::addInstrument(const InstrumentRecord & record)
+   {
+      std::string symbol = record.symbolName();
+      instruments_.insert(InstrumentMap::value_type(symbol, record.instrument()));
+      symbols_.push_back(Symbol(symbol));
+      subscribed_.push_back(false);
+   }
+
+   void InstrumentRecordFeed::addVariation(const InstrumentVariationRecord & record)
+   {
+      InstrumentVariationMap & variations = instrumentVariationProviders_[record.providerName()];
+      variations.insert(InstrumentVariationMap::value_type(record.symbolName(), record.variation()));
+   }
+
+   sint InstrumentRecordFeed::find(const std::string & symbol) const
+   {
+      for (sint ii = 0; ii < symbols_.size(); ++ii)
+      {
+         if (symbols_[ii].name() == symbol) return ii;
+      }
+      return -1;
+   }
+
+   void InstrumentRecordFeed::subscribe(const std::string & symbol)
+   {
+      sint ii = find(symbol);
+      if (ii < 0) throw Poco::NotFoundException("Not in the bar file: " + symbol);
+      subscribed_[ii] = true;
+   }
+
+   void InstrumentRecordFeed::unsubscribe(const std::string & symbol)
+   {
+      sint ii = find(symbol);
+      if (ii >= 0) subscribed_[ii] = false;
+   }
+}
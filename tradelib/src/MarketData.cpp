@@ -0,0 +1,71 @@
+// libraries headers
+#include "Poco/Exception.h"
+
+// tradelib headers
+#include "tradelib/MarketData.h"
+
+namespace tradelib
+{
+   MarketData::MarketData(DataFeed & source, const std::vector<std::string> & symbols)
+      : symbols_(symbols), variations_(source.instrumentVariations())
+   {
+      for (auto & ss : symbols_)
+      {
+         const Instrument * instrument = source.getInstrument(ss);
+         if (instrument == nullptr) throw Poco::NotFoundException("No instrument for " + ss);
+         instruments_.push_back(*instrument);
+         source.subscribe(ss);
+      }
+
+      source.barEvent.connect<MarketData, &MarketData::barEventHandler>(this);
+      try
+      {
+         source.start();
+      }
+      catch (...)
+      {
+         source.barEvent.disconnect(this);
+         throw;
+      }
+      source.barEvent.disconnect(this);
+   }
+
+   void MarketData::barEventHandler(const Bar & bar)
+   {
+      bars_.push_back(bar);
+
+      if (bar.symbol.id() >= closes_.size()) closes_.resize(bar.symbol.id() + 1);
+      closes_[bar.symbol.id()].push_back(bar.timestamp, bar.close);
+   }
+
+   MarketDataFeed::MarketDataFeed(std::shared_ptr<const MarketData> data)
+      : data_(data)
+   {
+      for (auto & ii : data_->instruments()) instruments_.insert(InstrumentMap::value_type(ii.symbol().name(), ii));
+      instrumentVariationProviders_ = data_->variations();
+   }
+
+   void MarketDataFeed::subscribe(const std::string & symbol)
+   {
+      const Instrument * instrument = getInstrument(symbol);
+      if (instrument == nullptr) throw Poco::NotFoundException("Not in the market data: " + symbol);
+
+      uint32 id = instrument->symbol().id();
+      if (id >= subscribed_.size()) subscribed_.resize(id + 1, false);
+      subscribed_[id] = true;
+   }
+
+   void MarketDataFeed::unsubscribe(const std::string & symbol)
+   {
+      const Instrument * instrument = getInstrument(symbol);
+      if (instrument != nullptr && instrument->symbol().id() < subscribed_.size()) subscribed_[instrument->symbol().id()] = false;
+   }
+
+   void MarketDataFeed::start()
+   {
+      for (const Bar & bar : data_->bars())
+      {
+         if (isSubscribed(bar.symbol)) barEvent(bar);
+      }
+   }
+}
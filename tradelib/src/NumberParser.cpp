@@ -0,0 +1,18 @@
+// std headers
+#include <string>
+
+// tradelib headers
+#include "tradelib/NumberParser.h"
+
+namespace tradelib
+{
+   numeric NumberParser::parseNumericSlow(const char * begin, const char * end)
+   {
+      return std::stod(std::string(begin, end));
+   }
+
+   long NumberParser::parseLongSlow(const char * begin, const char * end)
+   {
+      return std::stol(std::string(begin, end));
+   }
+}
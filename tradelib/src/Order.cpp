@@ -1,4 +1,5 @@
 #include "tradelib/Order.h"
+#include "tradelib/Serialization.h"
 
 namespace tradelib
 {
@@ -220,7 +221,7 @@ namespace tradelib
                   fillPrice = executeOnLimitOrStop ? this->stopPrice : tick.price;
                   poco_assert_dbg(this->quantity > 0);
                   filledQuantity = this->quantity;
-                  transactionQuantity = -filledQuantity;
+                  transactionQuantity = filledQuantity;
                   newPosition = this->quantity;
                }
             }
@@ -234,7 +235,7 @@ namespace tradelib
                   filled = true;
                   fillPrice = executeOnLimitOrStop ? this->stopPrice : tick.price;
                   filledQuantity = computeFilledQuantity(position);
-                  transactionQuantity = -filledQuantity;
+                  transactionQuantity = filledQuantity;
                   newPosition = 0;
                }
             }
@@ -376,7 +377,7 @@ namespace tradelib
                      filled = true;
                      fillPrice = executeOnLimitOrStop ? this->limitPrice : tick.price;
                      filledQuantity = computeFilledQuantity(position);
-                     transactionQuantity = -filledQuantity;
+                     transactionQuantity = filledQuantity;
                      newPosition = 0;
                   }
                }
@@ -387,7 +388,7 @@ namespace tradelib
                      filled = true;
                      fillPrice = executeOnLimitOrStop ? this->stopPrice : tick.price;
                      filledQuantity = computeFilledQuantity(position);
-                     transactionQuantity = -filledQuantity;
+                     transactionQuantity = filledQuantity;
                      newPosition = 0;
                   }
                   else
@@ -403,6 +404,77 @@ namespace tradelib
       return filled;
    }
 
+   Order::Trigger Order::trigger(numeric & price) const
+   {
+      switch (type_)
+      {
+      case ENTER_LONG_LIMIT:
+      case EXIT_SHORT_LIMIT:
+         price = limitPrice;
+         return Trigger::FALLING;
+
+      case ENTER_SHORT_LIMIT:
+      case EXIT_LONG_LIMIT:
+         price = limitPrice;
+         return Trigger::RISING;
+
+      case ENTER_LONG_STOP:
+      case EXIT_SHORT_STOP:
+         price = stopPrice;
+         return Trigger::RISING;
+
+      case EXIT_LONG_STOP:
+      case ENTER_SHORT_STOP:
+         price = stopPrice;
+         return Trigger::FALLING;
+
+      case ENTER_LONG_STOP_LIMIT:
+      case EXIT_SHORT_STOP_LIMIT:
+         price = isStopped() ? limitPrice : stopPrice;
+         return isStopped() ? Trigger::FALLING : Trigger::RISING;
+
+      case EXIT_LONG_STOP_LIMIT:
+      case ENTER_SHORT_STOP_LIMIT:
+         price = isStopped() ? limitPrice : stopPrice;
+         return isStopped() ? Trigger::RISING : Trigger::FALLING;
+
+      default:
+         return Trigger::NONE;
+      }
+   }
+
+   void Order::setTriggerPrice(numeric price)
+   {
+      switch (type_)
+      {
+      case ENTER_LONG_LIMIT:
+      case EXIT_SHORT_LIMIT:
+      case ENTER_SHORT_LIMIT:
+      case EXIT_LONG_LIMIT:
+         limitPrice = price;
+         break;
+
+      case ENTER_LONG_STOP:
+      case EXIT_SHORT_STOP:
+      case EXIT_LONG_STOP:
+      case ENTER_SHORT_STOP:
+         stopPrice = price;
+         break;
+
+      case ENTER_LONG_STOP_LIMIT:
+      case EXIT_SHORT_STOP_LIMIT:
+      case EXIT_LONG_STOP_LIMIT:
+      case ENTER_SHORT_STOP_LIMIT:
+         if (isStopped()) limitPrice = price;
+         else stopPrice = price;
+         break;
+
+      default:
+         // Market orders have no price
+         break;
+      }
+   }
+
    void Order::updateState(const Bar & bar)
    {
       // Check whether the order requires processing (bar expiration is set and is active)
@@ -438,4 +510,36 @@ namespace tradelib
       barsValidFor_ = (sint)numBars;
       lastBar_ = TIMESTAMP_MIN;
    }
+
+   void Order::save(Poco::BinaryWriter & writer) const
+   {
+      serialize(writer, symbol);
+      writer << static_cast<Poco::Int64>(quantity) << limitPrice << stopPrice << fillPrice << signal;
+      writer << static_cast<Poco::UInt32>(type_) << static_cast<Poco::UInt32>(state_) << static_cast<Poco::UInt32>(flags_);
+      writer << static_cast<Poco::Int64>(barsValidFor_);
+      serialize(writer, lastBar_);
+      writer << static_cast<Poco::UInt64>(sibling_) << static_cast<Poco::UInt64>(child_);
+   }
+
+   void Order::load(Poco::BinaryReader & reader)
+   {
+      Poco::Int64 q, barsValidFor;
+      Poco::UInt32 type, state, flags;
+      Poco::UInt64 sibling, child;
+
+      deserialize(reader, symbol);
+      reader >> q >> limitPrice >> stopPrice >> fillPrice >> signal;
+      reader >> type >> state >> flags;
+      reader >> barsValidFor;
+      deserialize(reader, lastBar_);
+      reader >> sibling >> child;
+
+      quantity = static_cast<long>(q);
+      type_ = type;
+      state_ = static_cast<State>(state);
+      flags_ = flags;
+      barsValidFor_ = static_cast<sint>(barsValidFor);
+      sibling_ = sibling;
+      child_ = child;
+   }
 }
\ No newline at end of file
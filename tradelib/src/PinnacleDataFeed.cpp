@@ -3,10 +3,14 @@
 #include "Poco/Data/RecordSet.h"
 #include "Poco/Data/Session.h"
 #include "Poco/Data/Statement.h"
+#include "Poco/DateTimeParser.h"
+#include "Poco/File.h"
 #include "Poco/FileStream.h"
 #include "Poco/JSON/Parser.h"
 #include "Poco/Path.h"
 
+#include "tradelib/BarCache.h"
+#include "tradelib/BarIndex.h"
 #include "tradelib/PinnacleDataFeed.h"
 
 namespace tradelib
@@ -25,6 +29,35 @@ namespace tradelib
          if (key == "directory") path_ = Poco::Path::forDirectory(kvrs[1].convert<std::string>());
          else if (key == "suffix") suffix_ = kvrs[1].convert<std::string>();
          else if (key == "date_format") format_ = kvrs[1].convert<std::string>();
+         else if (key == "bar_cache")
+         {
+            std::string value = Poco::toLower(kvrs[1].convert<std::string>());
+            if (value == "off") barCache_ = BarCacheMode::OFF;
+            else if (value == "on") barCache_ = BarCacheMode::ON;
+            else if (value == "build") barCache_ = BarCacheMode::BUILD;
+            else throw Poco::InvalidArgumentException("bar_cache must be one of: off, on, build");
+         }
+         else if (key == "decode_threads")
+         {
+            decodeThreads_ = kvrs[1].convert<sint>();
+            if (decodeThreads_ < 0) throw Poco::InvalidArgumentException("decode_threads must not be negative");
+         }
+         else if (key == "prefetch_depth")
+         {
+            prefetchDepth_ = kvrs[1].convert<sint>();
+            if (prefetchDepth_ < 1) throw Poco::InvalidArgumentException("prefetch_depth must be positive");
+         }
+         else if (key == "start_date")
+         {
+            int tzd;
+            start_ = Poco::DateTimeParser::parse("%Y-%m-%d", kvrs[1].convert<std::string>(), tzd).timestamp();
+         }
+         else if (key == "end_date")
+         {
+            // Inclusive - the range ends at the beginning of the next day
+            int tzd;
+            end_ = Poco::DateTimeParser::parse("%Y-%m-%d", kvrs[1].convert<std::string>(), tzd).timestamp() + Timespan(1, 0, 0, 0, 0);
+         }
       }
 
       // Load the instruments
@@ -104,57 +137,100 @@ namespace tradelib
       // Check for duplicates
       for (auto & aa : readers_)
       {
-         if (symbol == aa.symbol()) return;
+         if (symbol == aa->symbol()) return;
       }
 
       path_.setFileName(symbol + suffix_);
-      readers_.emplace_back(symbol, path_.toString(), format_);
+      std::string path = path_.toString();
+
+      // Archived data may only be available compressed
+      if (!CsvReader::isCompressed(path) && !Poco::File(path).exists() && Poco::File(path + ".gz").exists()) path += ".gz";
+
+      readers_.emplace_back(openReader(symbol, path));
    }
 
-   void PinnacleDataFeed::unsubscribe(const std::string & symbol)
+   std::unique_ptr<BarReader> PinnacleDataFeed::openReader(const std::string & symbol, const std::string & path)
    {
-      for (auto it = std::begin(readers_); it != std::end(readers_); ++it)
+      if (barCache_ != BarCacheMode::OFF)
       {
-         if (it->symbol() == symbol)
+         bool fresh = BarCache::isFresh(path, format_);
+         if (!fresh && barCache_ == BarCacheMode::BUILD)
          {
-            readers_.erase(it);
-            break;
+            BarCache::convert(symbol, path, format_);
+            fresh = true;
          }
-      }
-   }
-
-   void PinnacleDataFeed::start()
-   {
-      Bar bar;
-
-      while (true)
-      {
-         Timestamp timestamp = TIMESTAMP_MAX;
-         sint minIndex = -1;
 
-         for (sint ii = 0; ii < readers_.size(); ++ii)
+         if (fresh)
          {
-            if (readers_[ii].peek(bar) && bar.timestamp < timestamp)
+            try
+            {
+               std::unique_ptr<BarReader> reader(new BarCacheReader(symbol, BarCache::cachePath(path)));
+               reader->setRange(start_, end_);
+               return reader;
+            }
+            catch (BarCacheException &)
             {
-               timestamp = bar.timestamp;
-               minIndex = ii;
+               // A damaged cache - fall back to the CSV
             }
          }
+      }
+
+      std::unique_ptr<BarFileReader> reader(new BarFileReader(symbol, path, format_));
+      reader->setRange(start_, end_);
 
-         if (minIndex != -1)
+      // Seek close to the start of the range instead of parsing everything before it
+      if (start_ != TIMESTAMP_MIN && !CsvReader::isCompressed(path))
+      {
+         try
          {
-            readers_[minIndex].next(bar);
-            // fire the event
-            barEvent(bar);
+            if (!BarIndex::isFresh(path, format_)) BarIndex::build(path, format_);
+            reader->seek(BarIndex(BarIndex::indexPath(path)).offset(start_));
          }
-         else
+         catch (Poco::Exception &)
+         {
+            // The index is an optimization - without one (a read-only directory for instance)
+            // the rows before the range are skipped one by one
+         }
+      }
+
+      return std::unique_ptr<BarReader>(reader.release());
+   }
+
+   void PinnacleDataFeed::unsubscribe(const std::string & symbol)
+   {
+      for (auto it = std::begin(readers_); it != std::end(readers_); ++it)
+      {
+         if ((*it)->symbol() == symbol)
          {
-            // The feed is exhausted
+            readers_.erase(it);
             break;
          }
       }
    }
 
+   namespace
+   {
+      // Fires the bar event for every bar
+      class BarEventHandler
+      {
+      public:
+         BarEventHandler(Event<const Bar> & event)
+            : event_(event)
+         {}
+
+         void onBar(const Bar & bar) { event_(bar); }
+
+      protected:
+         Event<const Bar> & event_;
+      };
+   }
+
+   void PinnacleDataFeed::start()
+   {
+      BarEventHandler handler(barEvent);
+      run(handler);
+   }
+
    void PinnacleDataFeed::reset()
    {
       readers_.resize(0);
@@ -9,6 +9,7 @@
 #include "tradelib/Indicators.h"
 #include "tradelib/Instrument.h"
 #include "tradelib/Portfolio.h"
+#include "tradelib/Serialization.h"
 
 namespace tradelib
 {
@@ -274,35 +275,105 @@ namespace tradelib
 
    void Portfolio::addInstrument(const Instrument & instrument)
    {
-      poco_assert(data_.find(instrument.symbol()) == data_.end());
-      data_.emplace(instrument.symbol(), TransactionCollection());
+      poco_assert(find(instrument.symbol()) == nullptr);
+      findOrAdd(instrument.symbol());
    }
 
-   void Portfolio::appendTransaction(const Instrument & instrument, Timestamp t, long quantity, numeric price, numeric fees)
+   void Portfolio::merge(const Portfolio & other)
+   {
+      if (other.data_.size() > data_.size()) data_.resize(other.data_.size());
+      for (sint ii = 0; ii < other.data_.size(); ++ii)
+      {
+         if (!other.data_[ii]) continue;
+         poco_assert(!data_[ii]);
+         data_[ii].reset(new TransactionCollection(*other.data_[ii]));
+      }
+   }
+
+   void Portfolio::save(Poco::BinaryWriter & writer) const
+   {
+      Poco::UInt32 count = 0;
+      for (auto & tc : data_) if (tc) ++count;
+
+      writer << count;
+      for (sint ii = 0; ii < data_.size(); ++ii)
+      {
+         if (!data_[ii]) continue;
+         writer << SymbolTable::instance().name(static_cast<uint32>(ii));
+         data_[ii]->save(writer);
+      }
+   }
+
+   void Portfolio::load(Poco::BinaryReader & reader)
+   {
+      clear();
+
+      Poco::UInt32 count = 0;
+      reader >> count;
+      for (Poco::UInt32 ii = 0; ii < count && reader.good(); ++ii)
+      {
+         Symbol symbol;
+         deserialize(reader, symbol);
+         findOrAdd(symbol).load(reader);
+      }
+   }
+
+   void Portfolio::TransactionCollection::save(Poco::BinaryWriter & writer) const
    {
-      auto it = data_.find(instrument.symbol());
-      if (it == data_.end())
+      writer << static_cast<Poco::UInt64>(container_.size());
+      for (auto & tt : container_)
       {
-         data_.emplace(instrument.symbol(), TransactionCollection()).first->second.append(instrument, t, quantity, price, fees);
+         serialize(writer, tt.timestamp);
+         writer << static_cast<Poco::Int64>(tt.quantity) << tt.price << tt.value << tt.averageCost;
+         writer << static_cast<Poco::Int64>(tt.positionQuantity) << tt.positionAverageCost << tt.grossPnl << tt.netPnl << tt.fees;
       }
-      else
+   }
+
+   void Portfolio::TransactionCollection::load(Poco::BinaryReader & reader)
+   {
+      Poco::UInt64 size = 0;
+      reader >> size;
+      container_.clear();
+      container_.reserve(static_cast<size_t>(size));
+      for (Poco::UInt64 ii = 0; ii < size && reader.good(); ++ii)
       {
-         it->second.append(instrument, t, quantity, price, fees);
+         Timestamp timestamp;
+         Poco::Int64 quantity, positionQuantity;
+         deserialize(reader, timestamp);
+         container_.emplace_back(timestamp);
+
+         Transaction & tt = container_.back();
+         reader >> quantity >> tt.price >> tt.value >> tt.averageCost;
+         reader >> positionQuantity >> tt.positionAverageCost >> tt.grossPnl >> tt.netPnl >> tt.fees;
+         tt.quantity = static_cast<long>(quantity);
+         tt.positionQuantity = static_cast<long>(positionQuantity);
       }
    }
 
+   Portfolio::TransactionCollection & Portfolio::findOrAdd(const Symbol & symbol)
+   {
+      if (symbol.id() >= data_.size()) data_.resize(symbol.id() + 1);
+      if (!data_[symbol.id()]) data_[symbol.id()].reset(new TransactionCollection());
+      return *data_[symbol.id()];
+   }
+
+   void Portfolio::appendTransaction(const Instrument & instrument, Timestamp t, long quantity, numeric price, numeric fees)
+   {
+      findOrAdd(instrument.symbol()).append(instrument, t, quantity, price, fees);
+   }
+
    void Portfolio::getPositionPnl(const Instrument & instrument, numeric price, numeric & realized, numeric & unrealized) const
    {
-      auto it = data_.find(instrument.symbol());
-      poco_assert(it != data_.end());
-      it->second.getPositionPnl(instrument, price, realized, unrealized);
+      const TransactionCollection * transactions = find(instrument.symbol());
+      poco_assert(transactions != nullptr);
+      transactions->getPositionPnl(instrument, price, realized, unrealized);
    }
 
    void Portfolio::getPnl(const Instrument & instrument, const NumericIndexer & prices, NumericIndexer & pnl) const
    {
-      auto it = data_.find(instrument.symbol());
-      if (it == data_.end()) return;
-      it->second.getPnl(instrument, prices, pnl);
+      const TransactionCollection * transactions = find(instrument.symbol());
+      if (transactions == nullptr) return;
+      transactions->getPnl(instrument, prices, pnl);
    }
 
    // The work area (WA) to compute a TradeSummary
@@ -423,7 +494,11 @@ namespace tradelib
    void Portfolio::getTradeStats(const Instrument & instrument, const NumericIndexer & pnl, TradeStatsVector & tradeStats, TradeSummary & all, TradeSummary & longs, TradeSummary & shorts) const
    {
       getTradeStats(instrument, tradeStats);
+      summarizeTrades(tradeStats, pnl, all, longs, shorts);
+   }
 
+   void Portfolio::summarizeTrades(const TradeStatsVector & tradeStats, const NumericIndexer & pnl, TradeSummary & all, TradeSummary & longs, TradeSummary & shorts)
+   {
       TradeSummaryWA shortsWA(pnl);
       TradeSummaryWA longsWA(pnl);
       TradeSummaryWA allWA(pnl);
@@ -451,9 +526,9 @@ namespace tradelib
 
    void Portfolio::getTradeStats(const Instrument & instrument, TradeStatsVector & tradeStats) const
    {
-      auto it = data_.find(instrument.symbol());
-      if (it == data_.end()) return;
-      it->second.getTradeStats(instrument, tradeStats);
+      const TransactionCollection * transactions = find(instrument.symbol());
+      if (transactions == nullptr) return;
+      transactions->getTradeStats(instrument, tradeStats);
    }
 
    std::ostream & operator<<(std::ostream & os, const Portfolio::Transaction & t)
@@ -13,159 +13,139 @@
 
 namespace tradelib
 {
-   void Strategy::enterLong(const std::string & symbol, long quantity)
+   OrderHandle Strategy::enterLong(const Symbol & symbol, long quantity)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::enterLong(symbol, quantity));
+      return broker_->submitOrder(Order::enterLong(symbol, quantity));
    }
 
-   void Strategy::enterLongLimit(const std::string & symbol, numeric limitPrice, long quantity)
+   OrderHandle Strategy::enterLongLimit(const Symbol & symbol, numeric limitPrice, long quantity)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::enterLongLimit(symbol, quantity, limitPrice));
+      return broker_->submitOrder(Order::enterLongLimit(symbol, quantity, limitPrice));
    }
-   void Strategy::enterLongStop(const std::string & symbol, numeric stopPrice, long quantity)
+   OrderHandle Strategy::enterLongStop(const Symbol & symbol, numeric stopPrice, long quantity)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::enterLongStop(symbol, quantity, stopPrice));
+      return broker_->submitOrder(Order::enterLongStop(symbol, quantity, stopPrice));
    }
-   void Strategy::enterLongStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity)
+   OrderHandle Strategy::enterLongStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::enterLongStopLimit(symbol, quantity, stopPrice, limitPrice));
+      return broker_->submitOrder(Order::enterLongStopLimit(symbol, quantity, stopPrice, limitPrice));
    }
 
-   void Strategy::enterLongStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity, uint barsValidFor)
+   OrderHandle Strategy::enterLongStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity, uint barsValidFor)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
       Order order = Order::enterLongStopLimit(symbol, quantity, stopPrice, limitPrice);
       order.setExpiration(barsValidFor);
-      broker_->submitOrder(order);
+      return broker_->submitOrder(order);
    }
 
-   void Strategy::exitLong(const std::string & symbol, long quantity)
+   OrderHandle Strategy::exitLong(const Symbol & symbol, long quantity)
    {
       poco_assert(quantity > 0 || quantity == -1);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::exitLong(symbol, quantity));
+      return broker_->submitOrder(Order::exitLong(symbol, quantity));
    }
 
-   void Strategy::exitLongLimit(const std::string & symbol, numeric limitPrice, long quantity)
+   OrderHandle Strategy::exitLongLimit(const Symbol & symbol, numeric limitPrice, long quantity)
    {
       poco_assert(quantity > 0 || quantity == -1);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::exitLongLimit(symbol, quantity, limitPrice));
+      return broker_->submitOrder(Order::exitLongLimit(symbol, quantity, limitPrice));
    }
 
-   void Strategy::exitLongStop(const std::string & symbol, numeric stopPrice, long quantity)
+   OrderHandle Strategy::exitLongStop(const Symbol & symbol, numeric stopPrice, long quantity)
    {
       poco_assert(quantity > 0 || quantity == -1);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::exitLongStop(symbol, quantity, stopPrice));
+      return broker_->submitOrder(Order::exitLongStop(symbol, quantity, stopPrice));
 
    }
-   void Strategy::exitLongStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity)
+   OrderHandle Strategy::exitLongStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity)
    {
       poco_assert(quantity > 0 || quantity == -1);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::exitLongStopLimit(symbol, quantity, stopPrice, limitPrice));
+      return broker_->submitOrder(Order::exitLongStopLimit(symbol, quantity, stopPrice, limitPrice));
    }
 
-   void Strategy::enterShort(const std::string & symbol, long quantity)
+   OrderHandle Strategy::enterShort(const Symbol & symbol, long quantity)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::enterShort(symbol, quantity));
+      return broker_->submitOrder(Order::enterShort(symbol, quantity));
    }
 
-   void Strategy::enterShortLimit(const std::string & symbol, numeric limitPrice, long quantity)
+   OrderHandle Strategy::enterShortLimit(const Symbol & symbol, numeric limitPrice, long quantity)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::enterShortLimit(symbol, quantity, limitPrice));
+      return broker_->submitOrder(Order::enterShortLimit(symbol, quantity, limitPrice));
    }
 
-   void Strategy::enterShortStop(const std::string & symbol, numeric stopPrice, long quantity)
+   OrderHandle Strategy::enterShortStop(const Symbol & symbol, numeric stopPrice, long quantity)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::enterShortStop(symbol, quantity, stopPrice));
+      return broker_->submitOrder(Order::enterShortStop(symbol, quantity, stopPrice));
    }
 
-   void Strategy::enterShortStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity)
+   OrderHandle Strategy::enterShortStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::enterShortStopLimit(symbol, quantity, stopPrice, limitPrice));
+      return broker_->submitOrder(Order::enterShortStopLimit(symbol, quantity, stopPrice, limitPrice));
    }
 
-   void Strategy::enterShortStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity, uint barsValidFor)
+   OrderHandle Strategy::enterShortStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity, uint barsValidFor)
    {
       poco_assert(quantity > 0);
       poco_check_ptr(broker_);
       Order order = Order::enterShortStopLimit(symbol, quantity, stopPrice, limitPrice);
       order.setExpiration(barsValidFor);
-      broker_->submitOrder(order);
+      return broker_->submitOrder(order);
    }
 
-   void Strategy::exitShort(const std::string & symbol, long quantity)
+   OrderHandle Strategy::exitShort(const Symbol & symbol, long quantity)
    {
       poco_assert(quantity > 0 || quantity == -1);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::exitShort(symbol, quantity));
+      return broker_->submitOrder(Order::exitShort(symbol, quantity));
    }
 
-   void Strategy::exitShortLimit(const std::string & symbol, numeric limitPrice, long quantity)
+   OrderHandle Strategy::exitShortLimit(const Symbol & symbol, numeric limitPrice, long quantity)
    {
       poco_assert(quantity > 0 || quantity == -1);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::exitShortLimit(symbol, quantity, limitPrice));
+      return broker_->submitOrder(Order::exitShortLimit(symbol, quantity, limitPrice));
    }
 
-   void Strategy::exitShortStop(const std::string & symbol, numeric stopPrice, long quantity)
+   OrderHandle Strategy::exitShortStop(const Symbol & symbol, numeric stopPrice, long quantity)
    {
       poco_assert(quantity > 0 || quantity == -1);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::exitShortStop(symbol, quantity, stopPrice));
+      return broker_->submitOrder(Order::exitShortStop(symbol, quantity, stopPrice));
    }
 
-   void Strategy::exitShortStopLimit(const std::string & symbol, numeric stopPrice, numeric limitPrice, long quantity)
+   OrderHandle Strategy::exitShortStopLimit(const Symbol & symbol, numeric stopPrice, numeric limitPrice, long quantity)
    {
       poco_assert(quantity > 0 || quantity == -1);
       poco_check_ptr(broker_);
-      broker_->submitOrder(Order::exitShortStopLimit(symbol, quantity, stopPrice, limitPrice));
+      return broker_->submitOrder(Order::exitShortStopLimit(symbol, quantity, stopPrice, limitPrice));
    }
 
-   void Strategy::barOpenHandler(const void * sender, const Bar & bar)
+   BarSpill & Strategy::spillHistory(const Symbol & symbol, Timespan timespan, const std::string & path)
    {
-      BarHistory * history = barHistories_.lookup(bar.symbol, bar.timespan);
-      poco_check_ptr(history);
-      onBarOpen(*history, bar);
-   }
-
-   void Strategy::barCloseHandler(const void * sender, const Bar & bar)
-   {
-      BarHistory * history = barHistories_.lookupOrAdd(bar.symbol, bar.timespan);
-      history->append(bar);
-      onBarClose(*history, bar);
-   }
-
-   void Strategy::barClosedHandler(const void * sender, const Bar & bar)
-   {
-      BarHistory * history = barHistories_.lookup(bar.symbol, bar.timespan);
-      poco_check_ptr(history);
-      onBarClosed(*history, bar);
-   }
-
-   void Strategy::orderNotificationHandler(const void * sender, const OrderNotification & on)
-   {
-      logExecution(on);
-      onOrderNotification(on);
+      spills_.push_back(std::unique_ptr<BarSpill>(new BarSpill(path)));
+      barHistories_.lookupOrAdd(symbol, timespan)->setSpill(spills_.back().get());
+      return *spills_.back();
    }
 
    void Strategy::setupDb(const std::string & dbPath, bool cleanup)
@@ -0,0 +1,54 @@
+// std headers
+#include <ostream>
+
+// libraries headers
+#include "Poco/Exception.h"
+
+// tradelib headers
+#include "tradelib/Symbol.h"
+
+namespace tradelib
+{
+   SymbolTable & SymbolTable::instance()
+   {
+      static SymbolTable table;
+      return table;
+   }
+
+   SymbolTable::SymbolTable()
+      : size_(0)
+   {
+      // The empty symbol is id 0, what a default constructed Symbol refers to
+      intern(std::string());
+   }
+
+   uint32 SymbolTable::intern(const std::string & name)
+   {
+      Poco::FastMutex::ScopedLock lock(mutex_);
+
+      auto it = ids_.find(name);
+      if (it != ids_.end()) return it->second;
+
+      uint32 id = size_;
+      uint32 chunk = id >> CHUNK_BITS;
+      if (chunk == MAX_CHUNKS) throw Poco::RuntimeException("Too many symbols");
+      if (!chunks_[chunk]) chunks_[chunk].reset(new std::string[CHUNK_SIZE]);
+
+      // The name is in place before the id escapes the lock
+      chunks_[chunk][id & (CHUNK_SIZE - 1)] = name;
+      ids_.emplace(name, id);
+      ++size_;
+      return id;
+   }
+
+   uint32 SymbolTable::size() const
+   {
+      Poco::FastMutex::ScopedLock lock(mutex_);
+      return size_;
+   }
+
+   std::ostream & operator<<(std::ostream & os, const Symbol & symbol)
+   {
+      return os << symbol.name();
+   }
+}
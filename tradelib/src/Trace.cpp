@@ -0,0 +1,137 @@
+// std headers
+#include <istream>
+#include <map>
+#include <ostream>
+
+// libraries headers
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/File.h"
+#include "Poco/FileStream.h"
+
+// tradelib headers
+#include "tradelib/BinaryFile.h"
+#include "tradelib/Trace.h"
+
+namespace tradelib
+{
+   Trace::Trace(uint32 capacity)
+      : next_(0)
+   {
+      uint32 size = 1;
+      while (size < capacity && size < 0x80000000) size <<= 1;
+      records_.resize(size);
+      mask_ = size - 1;
+   }
+
+   void Trace::save(Poco::BinaryWriter & writer) const
+   {
+      // The symbol ids are only valid in this process, the names go along
+      std::map<uint32, std::string> symbols;
+      for (uint32 ii = 0; ii < size(); ++ii)
+      {
+         uint32 id = (*this)[ii].symbol;
+         if (symbols.find(id) == symbols.end()) symbols[id] = SymbolTable::instance().name(id);
+      }
+
+      writer << MAGIC << VERSION;
+      writer << static_cast<Poco::UInt32>(symbols.size());
+      for (auto & ss : symbols) writer << ss.first << ss.second;
+
+      writer << size() << static_cast<Poco::UInt64>(dropped());
+      for (uint32 ii = 0; ii < size(); ++ii)
+      {
+         const Record & r = (*this)[ii];
+         writer << static_cast<Poco::Int64>(r.timestamp) << static_cast<Poco::UInt64>(r.order) << r.price << r.quantity << r.symbol << static_cast<Poco::UInt8>(r.event);
+      }
+   }
+
+   void Trace::save(const std::string & path) const
+   {
+      BinaryFile::write<TraceException>(path, [this](std::ostream & os)
+      {
+         Poco::BinaryWriter writer(os);
+         save(writer);
+         writer.flush();
+      });
+   }
+
+   void Trace::dump(std::istream & is, std::ostream & os)
+   {
+      Poco::BinaryReader reader(is);
+      uint32 magic = 0;
+      uint32 version = 0;
+      reader >> magic >> version;
+      if (!reader.good()) throw TraceException("Not a trace");
+      BinaryFile::check<TraceException>(magic, version, MAGIC, VERSION, "");
+
+      Poco::UInt32 count = 0;
+      std::map<uint32, std::string> symbols;
+      reader >> count;
+      for (Poco::UInt32 ii = 0; ii < count && reader.good(); ++ii)
+      {
+         uint32 id;
+         reader >> id;
+         reader >> symbols[id];
+      }
+
+      Poco::UInt64 dropped = 0;
+      reader >> count >> dropped;
+      if (dropped > 0) os << "(" << dropped << " records dropped)" << std::endl;
+
+      for (Poco::UInt32 ii = 0; ii < count; ++ii)
+      {
+         Poco::Int64 timestamp;
+         Poco::UInt64 order;
+         numeric price;
+         sint32 quantity;
+         uint32 symbol;
+         Poco::UInt8 event;
+         reader >> timestamp >> order >> price >> quantity >> symbol >> event;
+         if (!reader.good()) throw TraceException("Truncated trace");
+
+         os << Poco::DateTimeFormatter::format(Timestamp(timestamp), "%Y-%m-%d %H:%M:%S") << " "
+            << symbols[symbol] << " "
+            << eventName(static_cast<Event>(event)) << " "
+            << "#" << static_cast<uint32>(order) << "/" << static_cast<uint32>(order >> 32) << " "
+            << quantity << " @ " << price << std::endl;
+      }
+   }
+
+   void Trace::dump(const std::string & path, std::ostream & os)
+   {
+      if (!Poco::File(path).exists()) throw TraceException("No trace: " + path);
+
+      Poco::FileInputStream is(path, std::ios::in | std::ios::binary);
+      try
+      {
+         dump(is, os);
+      }
+      catch (TraceException & e)
+      {
+         throw TraceException(e.message() + ": " + path);
+      }
+   }
+
+   const char * Trace::eventName(Event event)
+   {
+      switch (event)
+      {
+      case Event::SUBMIT:
+         return "SUBMIT";
+      case Event::TRIGGER:
+         return "TRIGGER";
+      case Event::FILL:
+         return "FILL";
+      case Event::CANCEL:
+         return "CANCEL";
+      case Event::EXPIRE:
+         return "EXPIRE";
+      case Event::POSITION:
+         return "POSITION";
+      default:
+         return "?";
+      }
+   }
+
+   POCO_IMPLEMENT_EXCEPTION(TraceException, Poco::Exception, "Bad trace")
+}